@@ -114,4 +114,18 @@ public:
 		return int32_t();
 	}
 
+	float getValueAsFloat(std::string name, float defaultValue)
+	{
+		assert(options.find(name) != options.end());
+		std::string value = options[name].value;
+		if (value != "") {
+			char* numConvPtr;
+			float floatVal = strtof(value.c_str(), &numConvPtr);
+			return ((numConvPtr != value.c_str()) && (floatVal >= 0.0f)) ? floatVal : defaultValue;
+		}
+		else {
+			return defaultValue;
+		}
+	}
+
 };
\ No newline at end of file
@@ -64,6 +64,16 @@ namespace vks
 	*/
 	VulkanDevice::~VulkanDevice()
 	{
+		if (uploadBatch.stagingBuffer)
+		{
+			vkUnmapMemory(logicalDevice, uploadBatch.stagingMemory);
+			vkDestroyBuffer(logicalDevice, uploadBatch.stagingBuffer, nullptr);
+			vkFreeMemory(logicalDevice, uploadBatch.stagingMemory, nullptr);
+		}
+		if (uploadBatch.fence)
+		{
+			vkDestroyFence(logicalDevice, uploadBatch.fence, nullptr);
+		}
 		if (commandPool)
 		{
 			vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
@@ -550,6 +560,151 @@ namespace vks
 		return flushCommandBuffer(commandBuffer, queue, commandPool, free);
 	}
 
+	/**
+	* Start recording an upload batch, or nest into the one that is currently being recorded
+	*
+	* @param queue Queue the batch will be submitted to (must support transfer)
+	*
+	* @note All copies staged until the matching (outermost) endUploadBatch are submitted with a single fence
+	* @note Upload batches are not thread safe and must be recorded from a single thread
+	*
+	* @return Command buffer to record copies and layout transitions into
+	*/
+	VkCommandBuffer VulkanDevice::beginUploadBatch(VkQueue queue)
+	{
+		if (uploadBatch.depth++ > 0)
+		{
+			return uploadBatch.commandBuffer;
+		}
+		uploadBatch.queue = queue;
+		if (uploadBatch.commandBuffer == VK_NULL_HANDLE)
+		{
+			uploadBatch.commandBuffer = createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, false);
+			VkFenceCreateInfo fenceInfo = vks::initializers::fenceCreateInfo(VK_FLAGS_NONE);
+			VK_CHECK_RESULT(vkCreateFence(logicalDevice, &fenceInfo, nullptr, &uploadBatch.fence));
+		}
+		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+		cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(uploadBatch.commandBuffer, &cmdBufInfo));
+		return uploadBatch.commandBuffer;
+	}
+
+	/**
+	* Get the command buffer of the upload batch that is currently being recorded
+	*
+	* @note The handle stays the same for the whole batch, even if staging data had to be flushed in between
+	*/
+	VkCommandBuffer VulkanDevice::getUploadCommandBuffer()
+	{
+		assert(uploadBatch.depth > 0);
+		return uploadBatch.commandBuffer;
+	}
+
+	/**
+	* Submit all copies recorded so far and wait for them, so the staging ring can be reused
+	*/
+	void VulkanDevice::submitUploadBatch()
+	{
+		auto &batch = uploadBatch;
+		VK_CHECK_RESULT(vkEndCommandBuffer(batch.commandBuffer));
+		VkSubmitInfo submitInfo = vks::initializers::submitInfo();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.commandBuffer;
+		VK_CHECK_RESULT(vkQueueSubmit(batch.queue, 1, &submitInfo, batch.fence));
+		VK_CHECK_RESULT(vkWaitForFences(logicalDevice, 1, &batch.fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
+		VK_CHECK_RESULT(vkResetFences(logicalDevice, 1, &batch.fence));
+		VK_CHECK_RESULT(vkResetCommandBuffer(batch.commandBuffer, 0));
+		batch.submitCount++;
+		batch.stagingOffset = 0;
+		for (auto &staging : batch.dedicatedStaging)
+		{
+			vkDestroyBuffer(logicalDevice, staging.first, nullptr);
+			vkFreeMemory(logicalDevice, staging.second, nullptr);
+		}
+		batch.dedicatedStaging.clear();
+	}
+
+	/**
+	* Copy data into the staging memory of the current upload batch
+	*
+	* @param data Pointer to the data to upload
+	* @param size Size of the data in bytes
+	* @param stagingBuffer Pointer to the handle of the buffer the data has been written to, used as the source of the copy
+	* @param (Optional) alignment Alignment of the returned offset (defaults to 16, which fits all texel block sizes used by the samples)
+	*
+	* @note If the staging ring is full, the copies recorded so far are submitted and waited for before the ring is reused
+	*
+	* @return Offset of the data inside the staging buffer
+	*/
+	VkDeviceSize VulkanDevice::stageUploadData(const void *data, VkDeviceSize size, VkBuffer *stagingBuffer, VkDeviceSize alignment)
+	{
+		assert(uploadBatch.depth > 0);
+		alignment = std::max(alignment, properties.limits.optimalBufferCopyOffsetAlignment);
+
+		// Uploads larger than the ring get a dedicated staging buffer that lives until the batch has been submitted
+		if (size > uploadBatch.stagingSize)
+		{
+			VkBuffer buffer;
+			VkDeviceMemory memory;
+			VK_CHECK_RESULT(createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, size, &buffer, &memory, const_cast<void *>(data)));
+			uploadBatch.dedicatedStaging.push_back(std::make_pair(buffer, memory));
+			*stagingBuffer = buffer;
+			return 0;
+		}
+
+		if (uploadBatch.stagingBuffer == VK_NULL_HANDLE)
+		{
+			VK_CHECK_RESULT(createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uploadBatch.stagingSize, &uploadBatch.stagingBuffer, &uploadBatch.stagingMemory));
+			VK_CHECK_RESULT(vkMapMemory(logicalDevice, uploadBatch.stagingMemory, 0, VK_WHOLE_SIZE, 0, (void **)&uploadBatch.stagingMapped));
+		}
+
+		VkDeviceSize offset = (uploadBatch.stagingOffset + alignment - 1) / alignment * alignment;
+		if (offset + size > uploadBatch.stagingSize)
+		{
+			// Ring is full, flush what has been recorded so far and continue with the same command buffer
+			submitUploadBatch();
+			VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+			cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			VK_CHECK_RESULT(vkBeginCommandBuffer(uploadBatch.commandBuffer, &cmdBufInfo));
+			offset = 0;
+		}
+		memcpy(uploadBatch.stagingMapped + offset, data, size);
+		uploadBatch.stagingOffset = offset + size;
+		*stagingBuffer = uploadBatch.stagingBuffer;
+		return offset;
+	}
+
+	/**
+	* Stage data and record a copy into a buffer as part of the current upload batch
+	*
+	* @param dstBuffer Buffer to copy to (must have the TRANSFER_DST usage flag set)
+	* @param data Pointer to the data to upload
+	* @param size Size of the data in bytes
+	* @param (Optional) dstOffset Offset into the destination buffer (defaults to 0)
+	*/
+	void VulkanDevice::uploadBuffer(VkBuffer dstBuffer, const void *data, VkDeviceSize size, VkDeviceSize dstOffset)
+	{
+		VkBuffer stagingBuffer;
+		VkBufferCopy copyRegion{};
+		copyRegion.srcOffset = stageUploadData(data, size, &stagingBuffer, 4);
+		copyRegion.dstOffset = dstOffset;
+		copyRegion.size = size;
+		vkCmdCopyBuffer(uploadBatch.commandBuffer, stagingBuffer, dstBuffer, 1, &copyRegion);
+	}
+
+	/**
+	* End the current upload batch, the outermost call submits all recorded copies and waits for them to finish
+	*/
+	void VulkanDevice::endUploadBatch()
+	{
+		assert(uploadBatch.depth > 0);
+		if (--uploadBatch.depth > 0)
+		{
+			return;
+		}
+		submitUploadBatch();
+	}
+
 	/**
 	* Check if an extension is supported by the (physical device)
 	*
@@ -48,6 +48,25 @@ struct VulkanDevice
 		uint32_t compute;
 		uint32_t transfer;
 	} queueFamilyIndices;
+	/** @brief Upload batch that staged buffer and image copies are recorded into (see beginUploadBatch) */
+	struct
+	{
+		VkQueue queue = VK_NULL_HANDLE;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		/** @brief Nesting depth, only the outermost endUploadBatch submits */
+		uint32_t depth = 0;
+		/** @brief Persistently mapped host visible staging ring shared by all uploads of a batch */
+		VkBuffer stagingBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+		uint8_t *stagingMapped = nullptr;
+		VkDeviceSize stagingSize = 64 * 1024 * 1024;
+		VkDeviceSize stagingOffset = 0;
+		/** @brief Staging buffers for uploads that don't fit into the ring, released once the batch has finished */
+		std::vector<std::pair<VkBuffer, VkDeviceMemory>> dedicatedStaging;
+		/** @brief Number of queue submissions done for uploads since device creation */
+		uint32_t submitCount = 0;
+	} uploadBatch;
 	operator VkDevice() const
 	{
 		return logicalDevice;
@@ -65,6 +84,12 @@ struct VulkanDevice
 	VkCommandBuffer createCommandBuffer(VkCommandBufferLevel level, bool begin = false);
 	void            flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, VkCommandPool pool, bool free = true);
 	void            flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free = true);
+	VkCommandBuffer beginUploadBatch(VkQueue queue);
+	VkCommandBuffer getUploadCommandBuffer();
+	VkDeviceSize    stageUploadData(const void *data, VkDeviceSize size, VkBuffer *stagingBuffer, VkDeviceSize alignment = 16);
+	void            uploadBuffer(VkBuffer dstBuffer, const void *data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+	void            submitUploadBatch();
+	void            endUploadBatch();
 	bool            extensionSupported(std::string extension);
 	VkFormat        getSupportedDepthFormat(bool checkSamplingSupport);
 };
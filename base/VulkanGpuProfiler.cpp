@@ -0,0 +1,146 @@
+/*
+* Vulkan GPU profiler
+*
+* Measures the GPU time of named scopes (e.g. render passes) using timestamp queries
+*
+* Copyright (C) 2026 by the games106 contributors
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanGpuProfiler.h"
+
+namespace vks
+{
+	/**
+	* Create the timestamp query pool
+	*
+	* @param device Vulkan device to create the query pool on, scopes must be recorded into command buffers of its graphics queue family
+	* @param slotCount Number of command buffers that record scopes and may be in flight at the same time
+	* @param maxScopesPerSlot Maximum number of scopes per command buffer, additional scopes are ignored
+	*/
+	void GpuProfiler::create(vks::VulkanDevice *device, uint32_t slotCount, uint32_t maxScopesPerSlot)
+	{
+		this->device = device;
+		this->maxScopesPerSlot = maxScopesPerSlot;
+		const uint32_t validBits = device->queueFamilyProperties[device->queueFamilyIndices.graphics].timestampValidBits;
+		supported = (device->properties.limits.timestampComputeAndGraphics == VK_TRUE) && (validBits > 0);
+		if (!supported) {
+			return;
+		}
+		timestampMask = (validBits >= 64) ? UINT64_MAX : ((uint64_t(1) << validBits) - 1);
+		timestampPeriod = device->properties.limits.timestampPeriod;
+		slots.assign(slotCount, Slot());
+
+		VkQueryPoolCreateInfo queryPoolCI{};
+		queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCI.queryCount = slotCount * maxScopesPerSlot * 2;
+		VK_CHECK_RESULT(vkCreateQueryPool(device->logicalDevice, &queryPoolCI, nullptr, &queryPool));
+		// Each query is read back as value and availability
+		queryData.resize(maxScopesPerSlot * 2 * 2);
+	}
+
+	void GpuProfiler::destroy()
+	{
+		if (queryPool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(device->logicalDevice, queryPool, nullptr);
+			queryPool = VK_NULL_HANDLE;
+		}
+		slots.clear();
+		results.clear();
+	}
+
+	void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t slot)
+	{
+		if (!supported) {
+			return;
+		}
+		recordingSlot = slot;
+		openScopes.clear();
+		// Slots beyond the created range (e.g. after the swap chain image count changed) are not measured
+		if (slot >= slots.size()) {
+			return;
+		}
+		slots[slot].scopes.clear();
+		vkCmdResetQueryPool(commandBuffer, queryPool, slot * maxScopesPerSlot * 2, maxScopesPerSlot * 2);
+	}
+
+	void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string &name)
+	{
+		if (!supported) {
+			return;
+		}
+		if ((recordingSlot >= slots.size()) || (slots[recordingSlot].scopes.size() >= maxScopesPerSlot)) {
+			// Keep begin and end balanced, the scope is simply not measured
+			openScopes.push_back(UINT32_MAX);
+			return;
+		}
+		Slot &slot = slots[recordingSlot];
+		const uint32_t firstQuery = (recordingSlot * maxScopesPerSlot + static_cast<uint32_t>(slot.scopes.size())) * 2;
+		slot.scopes.push_back({ name, static_cast<uint32_t>(openScopes.size()), firstQuery });
+		openScopes.push_back(firstQuery);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, firstQuery);
+	}
+
+	void GpuProfiler::endScope(VkCommandBuffer commandBuffer)
+	{
+		if (!supported) {
+			return;
+		}
+		assert(!openScopes.empty());
+		const uint32_t firstQuery = openScopes.back();
+		openScopes.pop_back();
+		if (firstQuery != UINT32_MAX) {
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, firstQuery + 1);
+		}
+	}
+
+	void GpuProfiler::collect(uint32_t slot)
+	{
+		if (!supported || (slot >= slots.size()) || slots[slot].scopes.empty()) {
+			return;
+		}
+		const uint32_t queryCount = static_cast<uint32_t>(slots[slot].scopes.size()) * 2;
+		// Queries that have not been written yet (e.g. the slot's command buffer was never submitted) are reported as unavailable instead of blocking
+		VkResult result = vkGetQueryPoolResults(device->logicalDevice, queryPool, slot * maxScopesPerSlot * 2, queryCount, queryCount * 2 * sizeof(uint64_t), queryData.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if ((result != VK_SUCCESS) && (result != VK_NOT_READY)) {
+			VK_CHECK_RESULT(result);
+		}
+		for (size_t i = 0; i < slots[slot].scopes.size(); i++) {
+			const uint64_t *begin = &queryData[i * 4];
+			const uint64_t *end = &queryData[i * 4 + 2];
+			if ((begin[1] == 0) || (end[1] == 0)) {
+				continue;
+			}
+			const uint64_t ticks = ((end[0] & timestampMask) - (begin[0] & timestampMask)) & timestampMask;
+			Result &scopeResult = getResult(slots[slot].scopes[i].name, slots[slot].scopes[i].depth);
+			scopeResult.ms = static_cast<double>(ticks) * timestampPeriod / 1000000.0;
+			scopeResult.totalMs += scopeResult.ms;
+			scopeResult.sampleCount++;
+		}
+	}
+
+	void GpuProfiler::resetStatistics()
+	{
+		for (Result &result : results) {
+			result.totalMs = 0.0;
+			result.sampleCount = 0;
+		}
+	}
+
+	// Results are kept in the order scopes are first seen, which matches the order of the passes in a frame
+	GpuProfiler::Result &GpuProfiler::getResult(const std::string &name, uint32_t depth)
+	{
+		for (Result &result : results) {
+			if (result.name == name) {
+				return result;
+			}
+		}
+		Result result;
+		result.name = name;
+		result.depth = depth;
+		results.push_back(result);
+		return results.back();
+	}
+}
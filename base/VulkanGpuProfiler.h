@@ -0,0 +1,81 @@
+/*
+* Vulkan GPU profiler
+*
+* Measures the GPU time of named scopes (e.g. render passes) using timestamp queries
+*
+* Copyright (C) 2026 by the games106 contributors
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include "vulkan/vulkan.h"
+#include "VulkanDevice.h"
+#include <string>
+#include <vector>
+
+namespace vks
+{
+/*
+	Timestamp queries are split into slots, one per command buffer that contains scopes (usually one per swap chain image)
+	Each slot is reset by the command buffer itself (beginFrame), so pre-recorded command buffers can be submitted repeatedly
+	Results of a slot are read back with collect once its last submission has finished, which never stalls the CPU
+*/
+class GpuProfiler
+{
+public:
+	/** @brief Accumulated timings of all scopes with the same name */
+	struct Result
+	{
+		std::string name;
+		/** @brief Nesting depth of the scope at the time it was recorded */
+		uint32_t depth = 0;
+		/** @brief GPU time of the most recently collected scope in milliseconds */
+		double ms = 0.0;
+		double totalMs = 0.0;
+		uint32_t sampleCount = 0;
+		double averageMs() const { return sampleCount > 0 ? totalMs / sampleCount : 0.0; }
+	};
+
+	/** @brief False if the device or graphics queue doesn't support timestamps, all functions are no-ops in that case */
+	bool supported = false;
+	std::vector<Result> results;
+
+	void create(vks::VulkanDevice *device, uint32_t slotCount, uint32_t maxScopesPerSlot = 32);
+	void destroy();
+	bool isCreated() const { return queryPool != VK_NULL_HANDLE; }
+	uint32_t getSlotCount() const { return static_cast<uint32_t>(slots.size()); }
+	/** @brief Resets the queries of a slot, must be recorded outside of a render pass before the first scope */
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t slot);
+	void beginScope(VkCommandBuffer commandBuffer, const std::string &name);
+	void endScope(VkCommandBuffer commandBuffer);
+	/** @brief Reads the results of a slot, call after the last submission of its command buffer has finished (e.g. after prepareFrame) */
+	void collect(uint32_t slot);
+	/** @brief Clears the accumulated totals (e.g. after a warmup phase) */
+	void resetStatistics();
+
+private:
+	struct Scope
+	{
+		std::string name;
+		uint32_t depth;
+		uint32_t firstQuery;
+	};
+	struct Slot
+	{
+		std::vector<Scope> scopes;
+	};
+	vks::VulkanDevice *device = nullptr;
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	uint32_t maxScopesPerSlot = 0;
+	uint64_t timestampMask = 0;
+	float timestampPeriod = 1.0f;
+	std::vector<Slot> slots;
+	// Slot and open scopes of the command buffer currently being recorded
+	uint32_t recordingSlot = 0;
+	std::vector<uint32_t> openScopes;
+	std::vector<uint64_t> queryData;
+	Result &getResult(const std::string &name, uint32_t depth);
+};
+}
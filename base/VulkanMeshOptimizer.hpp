@@ -0,0 +1,379 @@
+/*
+* Triangle mesh optimization and vertex welding helpers
+*
+* Vertex cache optimization based on "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+* by Sander, Nehab and Barczak (Tipsify), overdraw ordering based on the cluster sorting from the same paper
+*
+* Copyright (C) 2026 by the games106 contributors
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <glm/glm.hpp>
+
+namespace vks
+{
+	namespace meshoptimizer
+	{
+		/*
+			Vertex cache statistics of an index list
+			ACMR (average cache miss ratio) is the number of vertex shader invocations per triangle, 0.5 being the optimum for large regular meshes
+			ATVR (average transformed vertex ratio) is the number of vertex shader invocations per referenced vertex, 1.0 being the optimum
+		*/
+		struct VertexCacheStatistics
+		{
+			size_t triangles = 0;
+			size_t vertices = 0;
+			size_t transforms = 0;
+			float acmr() const { return triangles > 0 ? (float)transforms / (float)triangles : 0.0f; }
+			float atvr() const { return vertices > 0 ? (float)transforms / (float)vertices : 0.0f; }
+			VertexCacheStatistics& operator+=(const VertexCacheStatistics& other)
+			{
+				triangles += other.triangles;
+				vertices += other.vertices;
+				transforms += other.transforms;
+				return *this;
+			}
+		};
+
+		// Default size of the simulated post transform cache, roughly matches the effective cache size of current hardware
+		const uint32_t defaultCacheSize = 16;
+
+		/*
+			Simulates a FIFO post transform cache of the given size for a list of vertex indices in the range [0, vertexCount)
+		*/
+		inline VertexCacheStatistics analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = defaultCacheSize)
+		{
+			VertexCacheStatistics statistics;
+			statistics.triangles = indexCount / 3;
+			// Stores the "time" a vertex entered the cache, a vertex is still cached if less than cacheSize misses happened since
+			std::vector<size_t> cacheTimestamps(vertexCount, 0);
+			std::vector<bool> referenced(vertexCount, false);
+			size_t timestamp = cacheSize + 1;
+			for (size_t i = 0; i < indexCount; i++) {
+				const uint32_t index = indices[i];
+				if (timestamp - cacheTimestamps[index] > cacheSize) {
+					cacheTimestamps[index] = timestamp++;
+					statistics.transforms++;
+				}
+				if (!referenced[index]) {
+					referenced[index] = true;
+					statistics.vertices++;
+				}
+			}
+			return statistics;
+		}
+
+		/*
+			Reorders triangles for post transform vertex cache locality using Tipsify
+			Triangles are fanned around the vertex that keeps the most vertices in the cache, dead ends are resolved using a stack of recently used vertices
+			The first triangle of each cluster is written to clusters, and can be used for optimizeOverdraw
+			A new cluster starts at every dead end (hard boundary, the next fan does not reuse the cache of the current one anyway),
+			and after any fan that brings the local ACMR of the current cluster down to clusterThreshold (soft boundary, lambda in the paper),
+			which keeps the ACMR after reordering the clusters at roughly clusterThreshold
+		*/
+		inline void optimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>* clusters = nullptr, uint32_t cacheSize = defaultCacheSize, float clusterThreshold = 0.75f)
+		{
+			const size_t triangleCount = indexCount / 3;
+			if (clusters) {
+				clusters->clear();
+			}
+			if (triangleCount == 0) {
+				return;
+			}
+
+			// Vertex to triangle adjacency stored as offsets into a flat list
+			std::vector<uint32_t> liveTriangles(vertexCount, 0);
+			for (size_t i = 0; i < triangleCount * 3; i++) {
+				liveTriangles[indices[i]]++;
+			}
+			std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+			for (size_t i = 0; i < vertexCount; i++) {
+				adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+			}
+			std::vector<uint32_t> adjacency(triangleCount * 3);
+			{
+				std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t i = 0; i < triangleCount * 3; i++) {
+					adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+				}
+			}
+
+			std::vector<size_t> cacheTimestamps(vertexCount, 0);
+			std::vector<bool> emitted(triangleCount, false);
+			std::vector<uint32_t> deadEnds;
+			std::vector<uint32_t> candidates;
+			deadEnds.reserve(triangleCount * 3);
+			candidates.reserve(64);
+
+			size_t timestamp = cacheSize + 1;
+			size_t cursor = 0;
+			size_t outputIndex = 0;
+			int64_t fanningVertex = indices[0];
+			bool newCluster = true;
+			// The local ACMR of a cluster is measured with a cache that is flushed at the start of the cluster,
+			// as the cluster may be drawn after any other cluster once reordered by optimizeOverdraw
+			std::vector<size_t> clusterTimestamps(vertexCount, 0);
+			size_t clusterTimestamp = cacheSize + 1;
+			size_t clusterMisses = 0;
+			size_t clusterOutputIndex = 0;
+
+			while (fanningVertex >= 0) {
+				const uint32_t fanVertex = static_cast<uint32_t>(fanningVertex);
+				candidates.clear();
+				if (newCluster) {
+					if (clusters) {
+						clusters->push_back(static_cast<uint32_t>(outputIndex / 3));
+					}
+					clusterTimestamp += cacheSize + 1;
+					clusterMisses = 0;
+					clusterOutputIndex = outputIndex;
+				}
+				// Emit all live triangles around the fanning vertex
+				for (uint32_t a = adjacencyOffsets[fanVertex]; a < adjacencyOffsets[fanVertex + 1]; a++) {
+					const uint32_t triangle = adjacency[a];
+					if (emitted[triangle]) {
+						continue;
+					}
+					for (uint32_t v = 0; v < 3; v++) {
+						const uint32_t vertex = indices[triangle * 3 + v];
+						destination[outputIndex++] = vertex;
+						deadEnds.push_back(vertex);
+						candidates.push_back(vertex);
+						liveTriangles[vertex]--;
+						if (timestamp - cacheTimestamps[vertex] > cacheSize) {
+							cacheTimestamps[vertex] = timestamp++;
+						}
+						if (clusterTimestamp - clusterTimestamps[vertex] > cacheSize) {
+							clusterTimestamps[vertex] = clusterTimestamp++;
+							clusterMisses++;
+						}
+					}
+					emitted[triangle] = true;
+				}
+
+				// Select the next fanning vertex among the candidates that will still be in the cache after emitting its remaining triangles
+				fanningVertex = -1;
+				int64_t bestPriority = -1;
+				for (uint32_t vertex : candidates) {
+					if (liveTriangles[vertex] == 0) {
+						continue;
+					}
+					int64_t priority = 0;
+					const int64_t age = static_cast<int64_t>(timestamp - cacheTimestamps[vertex]);
+					if (age + 2 * static_cast<int64_t>(liveTriangles[vertex]) <= static_cast<int64_t>(cacheSize)) {
+						priority = age;
+					}
+					if (priority > bestPriority) {
+						bestPriority = priority;
+						fanningVertex = vertex;
+					}
+				}
+
+				// Soft cluster boundary once the cluster amortized its initial cache misses
+				const size_t clusterTriangles = (outputIndex - clusterOutputIndex) / 3;
+				newCluster = static_cast<float>(clusterMisses) <= clusterThreshold * static_cast<float>(clusterTriangles);
+				if (fanningVertex == -1) {
+					// Dead end, try the most recently used vertices first
+					// The jump breaks the fanning sequence, so this is a hard cluster boundary
+					newCluster = true;
+					while (!deadEnds.empty()) {
+						const uint32_t vertex = deadEnds.back();
+						deadEnds.pop_back();
+						if (liveTriangles[vertex] > 0) {
+							fanningVertex = vertex;
+							break;
+						}
+					}
+				}
+				if (fanningVertex == -1) {
+					// Nothing close left, continue with the next vertex in input order that still has triangles
+					newCluster = true;
+					while (cursor < indexCount) {
+						const uint32_t vertex = indices[cursor++];
+						if (liveTriangles[vertex] > 0) {
+							fanningVertex = vertex;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		/*
+			Sorts the triangle clusters generated by optimizeVertexCache so that clusters facing away from the center of the mesh are drawn first
+			These are the most likely to occlude other parts of the mesh, which reduces overdraw while keeping the vertex cache locality within clusters
+			Positions are read from vertexData using vertexStride (in bytes)
+		*/
+		inline void optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<uint32_t>& clusters, const uint8_t* vertexData, size_t vertexStride, glm::vec3 center)
+		{
+			const size_t triangleCount = indexCount / 3;
+			if (clusters.size() < 2) {
+				return;
+			}
+
+			struct Cluster {
+				uint32_t firstTriangle;
+				uint32_t triangleCount;
+				float sortKey;
+			};
+			std::vector<Cluster> sortedClusters(clusters.size());
+			for (size_t c = 0; c < clusters.size(); c++) {
+				Cluster& cluster = sortedClusters[c];
+				cluster.firstTriangle = clusters[c];
+				cluster.triangleCount = static_cast<uint32_t>((c + 1 < clusters.size() ? clusters[c + 1] : triangleCount) - clusters[c]);
+				// Area weighted centroid and normal of the cluster
+				glm::vec3 centroid(0.0f);
+				glm::vec3 normal(0.0f);
+				float area = 0.0f;
+				for (uint32_t t = cluster.firstTriangle; t < cluster.firstTriangle + cluster.triangleCount; t++) {
+					glm::vec3 p[3];
+					for (uint32_t v = 0; v < 3; v++) {
+						memcpy(&p[v], vertexData + indices[t * 3 + v] * vertexStride, sizeof(glm::vec3));
+					}
+					const glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+					const float triangleArea = glm::length(n);
+					centroid += (p[0] + p[1] + p[2]) * (triangleArea / 3.0f);
+					normal += n;
+					area += triangleArea;
+				}
+				if (area > 0.0f) {
+					centroid /= area;
+				}
+				const float normalLength = glm::length(normal);
+				cluster.sortKey = normalLength > 0.0f ? glm::dot(centroid - center, normal / normalLength) : 0.0f;
+			}
+			std::stable_sort(sortedClusters.begin(), sortedClusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+			std::vector<uint32_t> source(indices, indices + triangleCount * 3);
+			size_t outputIndex = 0;
+			for (const Cluster& cluster : sortedClusters) {
+				memcpy(&indices[outputIndex], &source[cluster.firstTriangle * 3], cluster.triangleCount * 3 * sizeof(uint32_t));
+				outputIndex += cluster.triangleCount * 3;
+			}
+		}
+
+		/*
+			Builds a remap table that maps each vertex to the first occurrence of an identical vertex, returns the number of unique vertices
+			With an epsilon of zero vertices are compared bitwise, otherwise vertexData is treated as tightly packed floats and
+			vertices are merged if all of their components round to the same multiple of epsilon
+			Vertices with non-finite components (or components too large to quantize) are never merged when welding with an epsilon
+			Unique vertices are numbered in order of their first occurrence, so the remap can be applied with remapVertexBuffer
+		*/
+		inline size_t generateVertexRemap(uint32_t* remap, const uint8_t* vertexData, size_t vertexCount, size_t vertexStride, float epsilon = 0.0f)
+		{
+			const size_t floatCount = vertexStride / sizeof(float);
+			const bool quantize = epsilon > 0.0f;
+			// Quantized copy of the vertices, so epsilon welding can use the same bitwise hashing and comparison
+			std::vector<int64_t> quantized;
+			std::vector<bool> unweldable;
+			if (quantize) {
+				quantized.resize(vertexCount * floatCount);
+				unweldable.resize(vertexCount, false);
+				for (size_t i = 0; i < vertexCount * floatCount; i++) {
+					float value;
+					memcpy(&value, vertexData + i * sizeof(float), sizeof(float));
+					const double scaled = std::floor(static_cast<double>(value) / epsilon + 0.5);
+					// The conversion to int64_t is undefined for NaN, infinity and out of range values
+					if (!std::isfinite(scaled) || std::fabs(scaled) >= 9.0e18) {
+						unweldable[i / floatCount] = true;
+						quantized[i] = 0;
+						continue;
+					}
+					quantized[i] = static_cast<int64_t>(scaled);
+				}
+			}
+			const uint8_t* keyData = quantize ? reinterpret_cast<const uint8_t*>(quantized.data()) : vertexData;
+			const size_t keySize = quantize ? floatCount * sizeof(int64_t) : vertexStride;
+
+			auto hash = [&](size_t vertex) {
+				// FNV-1a
+				const uint8_t* key = keyData + vertex * keySize;
+				uint64_t h = 14695981039346656037ull;
+				for (size_t i = 0; i < keySize; i++) {
+					h = (h ^ key[i]) * 1099511628211ull;
+				}
+				return h;
+			};
+
+			// Open addressing hash table storing vertex indices, sized to a power of two with a load factor of at most 0.5
+			const uint32_t empty = ~0u;
+			size_t tableSize = 1;
+			while (tableSize < vertexCount * 2) {
+				tableSize *= 2;
+			}
+			std::vector<uint32_t> table(tableSize, empty);
+
+			uint32_t uniqueCount = 0;
+			for (size_t i = 0; i < vertexCount; i++) {
+				if (quantize && unweldable[i]) {
+					remap[i] = uniqueCount++;
+					continue;
+				}
+				size_t slot = hash(i) & (tableSize - 1);
+				while (table[slot] != empty && memcmp(keyData + table[slot] * keySize, keyData + i * keySize, keySize) != 0) {
+					slot = (slot + 1) & (tableSize - 1);
+				}
+				if (table[slot] == empty) {
+					table[slot] = static_cast<uint32_t>(i);
+					remap[i] = uniqueCount++;
+				}
+				else {
+					remap[i] = remap[table[slot]];
+				}
+			}
+			return uniqueCount;
+		}
+
+		/*
+			Compacts vertexData to the unique vertices of a remap table generated by generateVertexRemap
+			As unique vertices are numbered in order of first occurrence, this can safely be done in place
+		*/
+		inline void remapVertexBuffer(uint8_t* vertexData, size_t vertexCount, size_t vertexStride, const uint32_t* remap)
+		{
+			uint32_t nextVertex = 0;
+			for (size_t i = 0; i < vertexCount; i++) {
+				if (remap[i] == nextVertex) {
+					if (i != nextVertex) {
+						memcpy(vertexData + nextVertex * vertexStride, vertexData + i * vertexStride, vertexStride);
+					}
+					nextVertex++;
+				}
+			}
+		}
+
+		/*
+			Reorders vertices in the order they are first referenced by the index list, so vertex fetches access memory mostly linearly
+			Indices are rewritten in place, unreferenced vertices are moved to the end
+		*/
+		inline void optimizeVertexFetch(uint8_t* vertexData, size_t vertexStride, uint32_t* indices, size_t indexCount, size_t vertexCount)
+		{
+			const uint32_t unused = ~0u;
+			std::vector<uint32_t> remap(vertexCount, unused);
+			uint32_t nextVertex = 0;
+			for (size_t i = 0; i < indexCount; i++) {
+				uint32_t& target = remap[indices[i]];
+				if (target == unused) {
+					target = nextVertex++;
+				}
+				indices[i] = target;
+			}
+			for (size_t i = 0; i < vertexCount; i++) {
+				if (remap[i] == unused) {
+					remap[i] = nextVertex++;
+				}
+			}
+			std::vector<uint8_t> source(vertexData, vertexData + vertexCount * vertexStride);
+			for (size_t i = 0; i < vertexCount; i++) {
+				memcpy(vertexData + remap[i] * vertexStride, &source[i * vertexStride], vertexStride);
+			}
+		}
+	}
+}
@@ -39,10 +39,16 @@ namespace vks
 		VkSampleCountFlagBits rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 		uint32_t subpass = 0;
 
-		vks::Buffer vertexBuffer;
-		vks::Buffer indexBuffer;
-		int32_t vertexCount = 0;
-		int32_t indexCount = 0;
+		// The draw data changes every frame (e.g. the frame time text), so each frame in flight has its own vertex and index buffer
+		struct FrameBuffers {
+			vks::Buffer vertexBuffer;
+			vks::Buffer indexBuffer;
+			int32_t vertexCount = 0;
+			int32_t indexCount = 0;
+		};
+		std::vector<FrameBuffers> frames;
+		// Number of frames in flight, needs to be set before calling prepareResources
+		uint32_t frameCount = 1;
 
 		std::vector<VkPipelineShaderStageCreateInfo> shaders;
 
@@ -72,8 +78,8 @@ namespace vks
 		void preparePipeline(const VkPipelineCache pipelineCache, const VkRenderPass renderPass, const VkFormat colorFormat, const VkFormat depthFormat);
 		void prepareResources();
 
-		bool update();
-		void draw(const VkCommandBuffer commandBuffer);
+		bool update(uint32_t frame = 0);
+		void draw(const VkCommandBuffer commandBuffer, uint32_t frame = 0);
 		void resize(uint32_t width, uint32_t height);
 
 		void freeResources();
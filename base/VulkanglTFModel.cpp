@@ -12,6 +12,26 @@
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 
 #include "VulkanglTFModel.h"
+#include "VulkanMeshOptimizer.hpp"
+#include "cpuprofiler.hpp"
+
+#include <memory>
+#include <array>
+#include <numeric>
+#include <functional>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <unordered_map>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 VkDescriptorSetLayout vkglTF::descriptorSetLayoutImage = VK_NULL_HANDLE;
 VkDescriptorSetLayout vkglTF::descriptorSetLayoutUbo = VK_NULL_HANDLE;
@@ -33,12 +53,244 @@ bool loadImageDataFunc(tinygltf::Image* image, const int imageIndex, std::string
 	return tinygltf::LoadImageData(image, imageIndex, error, warning, req_width, req_height, bytes, size, userData);
 }
 
+/*
+	Used with FileLoadingFlags::ParallelImageDecoding: only keeps the encoded image file, decoding is done by loadImages on worker threads
+	Encoded images are marked by a component count of zero
+*/
+bool loadImageDataFuncDeferred(tinygltf::Image* image, const int imageIndex, std::string* error, std::string* warning, int req_width, int req_height, const unsigned char* bytes, int size, void* userData)
+{
+	if (image->uri.find_last_of(".") != std::string::npos) {
+		if (image->uri.substr(image->uri.find_last_of(".") + 1) == "ktx") {
+			return true;
+		}
+	}
+
+	image->width = 0;
+	image->height = 0;
+	image->component = 0;
+	image->image.assign(bytes, bytes + size);
+	return true;
+}
+
 bool loadImageDataFuncEmpty(tinygltf::Image* image, const int imageIndex, std::string* error, std::string* warning, int req_width, int req_height, const unsigned char* bytes, int size, void* userData) 
 {
 	// This function will be used for samples that don't require images to be loaded
 	return true;
 }
 
+/*
+	Read-only memory mapping of a file, used to access glTF buffers without copying them to the heap
+*/
+class MappedFile
+{
+public:
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+
+	MappedFile() {};
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile()
+	{
+		unmap();
+	}
+
+	bool map(const std::string& filename)
+	{
+#if defined(_WIN32)
+		file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart == 0)) {
+			unmap();
+			return false;
+		}
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) {
+			unmap();
+			return false;
+		}
+		data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		size = static_cast<size_t>(fileSize.QuadPart);
+#else
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat fileStat;
+		if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size == 0)) {
+			::close(fd);
+			return false;
+		}
+		void* ptr = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		// The mapping stays valid after the descriptor has been closed
+		::close(fd);
+		if (ptr == MAP_FAILED) {
+			return false;
+		}
+		data = static_cast<const unsigned char*>(ptr);
+		size = static_cast<size_t>(fileStat.st_size);
+#endif
+		return data != nullptr;
+	}
+
+	void unmap()
+	{
+#if defined(_WIN32)
+		if (data) {
+			UnmapViewOfFile(data);
+		}
+		if (mapping) {
+			CloseHandle(mapping);
+			mapping = nullptr;
+		}
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+			file = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (data) {
+			munmap(const_cast<unsigned char*>(data), size);
+		}
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+private:
+#if defined(_WIN32)
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#endif
+};
+
+/*
+	Loads a glTF or glb file with all non-embedded buffers memory mapped
+
+	tinyglTF always copies buffer contents into std::vectors, so the buffers that can be mapped (the glb binary chunk and external .bin files)
+	are replaced by a one byte placeholder in the JSON before it's passed to tinyglTF. Images stored in buffer views of those buffers
+	are decoded directly from the mapping afterwards. bufferData receives the base address for every buffer of the model.
+*/
+bool loadMemoryMapped(tinygltf::TinyGLTF& gltfContext, tinygltf::Model& gltfModel, const std::string& filename, const std::string& basePath, bool binary, tinygltf::LoadImageDataFunction imageLoader, std::vector<std::unique_ptr<MappedFile>>& mappedFiles, std::vector<const unsigned char*>& bufferData, std::string& error, std::string& warning)
+{
+	const std::string placeholderBufferUri = "data:application/octet-stream;base64,AA==";
+	const std::string placeholderImageUri = "__vkgltf_mapped_buffer_view__";
+
+	std::unique_ptr<MappedFile> file(new MappedFile());
+	if (!file->map(filename)) {
+		error = "Could not map file";
+		return false;
+	}
+
+	const unsigned char* jsonData = file->data;
+	size_t jsonSize = file->size;
+	const unsigned char* binChunk = nullptr;
+	size_t binSize = 0;
+	if (binary) {
+		// glb layout: 12 byte header, JSON chunk, optional BIN chunk (each chunk starts with its length and type)
+		if ((file->size < 20) || (memcmp(file->data, "glTF", 4) != 0)) {
+			error = "Invalid glb file";
+			return false;
+		}
+		uint32_t jsonChunkLength;
+		memcpy(&jsonChunkLength, file->data + 12, sizeof(uint32_t));
+		if (20 + static_cast<size_t>(jsonChunkLength) > file->size) {
+			error = "Invalid glb JSON chunk";
+			return false;
+		}
+		jsonData = file->data + 20;
+		jsonSize = jsonChunkLength;
+		const size_t binChunkOffset = 20 + static_cast<size_t>(jsonChunkLength);
+		if (binChunkOffset + 8 <= file->size) {
+			uint32_t binChunkLength;
+			memcpy(&binChunkLength, file->data + binChunkOffset, sizeof(uint32_t));
+			binChunk = file->data + binChunkOffset + 8;
+			binSize = std::min(static_cast<size_t>(binChunkLength), file->size - binChunkOffset - 8);
+		}
+	}
+
+	nlohmann::json document = nlohmann::json::parse(jsonData, jsonData + jsonSize, nullptr, false);
+	if (document.is_discarded() || !document.is_object()) {
+		error = "Could not parse glTF JSON";
+		return false;
+	}
+	mappedFiles.push_back(std::move(file));
+
+	// Map all buffers that are not stored as data URIs
+	std::vector<const unsigned char*> mappedBuffers;
+	auto buffers = document.find("buffers");
+	if (buffers != document.end()) {
+		for (auto& buffer : *buffers) {
+			const size_t byteLength = buffer.value("byteLength", static_cast<size_t>(0));
+			const unsigned char* data = nullptr;
+			auto uri = buffer.find("uri");
+			if (uri == buffer.end()) {
+				if (binChunk && (byteLength <= binSize)) {
+					data = binChunk;
+				}
+			} else if (!tinygltf::IsDataURI(uri->get<std::string>())) {
+				std::unique_ptr<MappedFile> bufferFile(new MappedFile());
+				if (bufferFile->map(basePath + "/" + tinygltf::dlib::urldecode(uri->get<std::string>())) && (byteLength <= bufferFile->size)) {
+					data = bufferFile->data;
+					mappedFiles.push_back(std::move(bufferFile));
+				}
+			}
+			if (data) {
+				buffer["uri"] = placeholderBufferUri;
+				buffer["byteLength"] = 1;
+			}
+			mappedBuffers.push_back(data);
+		}
+	}
+
+	// Images stored in mapped buffers are decoded from the mapping after tinyglTF has parsed the model
+	std::vector<std::pair<int, int>> mappedImages;
+	auto images = document.find("images");
+	auto bufferViews = document.find("bufferViews");
+	if ((images != document.end()) && (bufferViews != document.end())) {
+		for (size_t i = 0; i < images->size(); i++) {
+			auto& image = (*images)[i];
+			auto bufferView = image.find("bufferView");
+			if (bufferView == image.end()) {
+				continue;
+			}
+			const int bufferViewIndex = bufferView->get<int>();
+			const int bufferIndex = (*bufferViews)[bufferViewIndex].value("buffer", -1);
+			if ((bufferIndex > -1) && (bufferIndex < static_cast<int>(mappedBuffers.size())) && mappedBuffers[bufferIndex]) {
+				mappedImages.push_back(std::make_pair(static_cast<int>(i), bufferViewIndex));
+				image.erase("bufferView");
+				image["uri"] = placeholderImageUri;
+			}
+		}
+	}
+
+	const std::string jsonString = document.dump();
+	if (!gltfContext.LoadASCIIFromString(&gltfModel, &error, &warning, jsonString.c_str(), static_cast<unsigned int>(jsonString.size()), basePath)) {
+		return false;
+	}
+
+	for (auto& mappedImage : mappedImages) {
+		tinygltf::Image& image = gltfModel.images[mappedImage.first];
+		image.uri.clear();
+		image.bufferView = mappedImage.second;
+		if (imageLoader) {
+			const tinygltf::BufferView& bufferView = gltfModel.bufferViews[mappedImage.second];
+			const unsigned char* bytes = mappedBuffers[bufferView.buffer] + bufferView.byteOffset;
+			if (!imageLoader(&image, mappedImage.first, &error, &warning, 0, 0, bytes, static_cast<int>(bufferView.byteLength), nullptr)) {
+				return false;
+			}
+		}
+	}
+
+	bufferData.resize(gltfModel.buffers.size());
+	for (size_t i = 0; i < gltfModel.buffers.size(); i++) {
+		bufferData[i] = ((i < mappedBuffers.size()) && mappedBuffers[i]) ? mappedBuffers[i] : gltfModel.buffers[i].data.data();
+	}
+	return true;
+}
+
 
 /*
 	glTF texture loading class
@@ -119,25 +371,11 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 		VkMemoryRequirements memReqs{};
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo{};
-		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferCreateInfo.size = bufferSize;
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
+		// The copy and the mip chain generation are recorded into the device's upload batch
+		VkCommandBuffer copyCmd = device->beginUploadBatch(copyQueue);
 
-		uint8_t* data;
-		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-		memcpy(data, buffer, bufferSize);
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
+		VkBuffer stagingBuffer;
+		VkDeviceSize stagingOffset = device->stageUploadData(buffer, bufferSize, &stagingBuffer);
 
 		VkImageCreateInfo imageCreateInfo{};
 		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -159,8 +397,6 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
 		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
 
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
 		VkImageSubresourceRange subresourceRange = {};
 		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		subresourceRange.levelCount = 1;
@@ -186,6 +422,7 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 		bufferCopyRegion.imageExtent.width = width;
 		bufferCopyRegion.imageExtent.height = height;
 		bufferCopyRegion.imageExtent.depth = 1;
+		bufferCopyRegion.bufferOffset = stagingOffset;
 
 		vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
 
@@ -201,13 +438,8 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 			vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
 		}
 
-		device->flushCommandBuffer(copyCmd, copyQueue, true);
-
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-
 		// Generate the mip chain (glTF uses jpg and png, so we need to create this manually)
-		VkCommandBuffer blitCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		VkCommandBuffer blitCmd = copyCmd;
 		for (uint32_t i = 1; i < mipLevels; i++) {
 			VkImageBlit imageBlit{};
 
@@ -277,7 +509,7 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
             delete[] buffer;
         }
 
-		device->flushCommandBuffer(blitCmd, copyQueue, true);
+		device->endUploadBatch();
 	}
 	else {
 		// Texture is stored in an external ktx file
@@ -320,29 +552,12 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 		VkFormatProperties formatProperties;
 		vkGetPhysicalDeviceFormatProperties(device->physicalDevice, format, &formatProperties);
 
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		VkCommandBuffer copyCmd = device->beginUploadBatch(copyQueue);
 		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-		bufferCreateInfo.size = ktxTextureSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
+		VkDeviceSize stagingOffset = device->stageUploadData(ktxTextureData, ktxTextureSize, &stagingBuffer);
 
 		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
 		VkMemoryRequirements memReqs;
-		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-		uint8_t* data;
-		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-		memcpy(data, ktxTextureData, ktxTextureSize);
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
 
 		std::vector<VkBufferImageCopy> bufferCopyRegions;
 		for (uint32_t i = 0; i < mipLevels; i++)
@@ -358,7 +573,7 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 			bufferCopyRegion.imageExtent.width = std::max(1u, ktxTexture->baseWidth >> i);
 			bufferCopyRegion.imageExtent.height = std::max(1u, ktxTexture->baseHeight >> i);
 			bufferCopyRegion.imageExtent.depth = 1;
-			bufferCopyRegion.bufferOffset = offset;
+			bufferCopyRegion.bufferOffset = stagingOffset + offset;
 			bufferCopyRegions.push_back(bufferCopyRegion);
 		}
 
@@ -391,12 +606,9 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 		vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
 		vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
 		vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-		device->flushCommandBuffer(copyCmd, copyQueue);
+		device->endUploadBatch();
 		this->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-
 		ktxTexture_Destroy(ktxTexture);
 	}
 
@@ -482,6 +694,15 @@ void vkglTF::Primitive::setDimensions(glm::vec3 min, glm::vec3 max) {
 	dimensions.radius = glm::distance(min, max) / 2.0f;
 }
 
+void vkglTF::Primitive::getBounds(const glm::mat4& matrix, glm::vec3& min, glm::vec3& max) const {
+	// Transform the box center and project its extents onto the axes
+	const glm::vec3 center = glm::vec3(matrix * glm::vec4((dimensions.min + dimensions.max) * 0.5f, 1.0f));
+	const glm::vec3 extents = (dimensions.max - dimensions.min) * 0.5f;
+	const glm::vec3 transformedExtents = glm::abs(glm::vec3(matrix[0])) * extents.x + glm::abs(glm::vec3(matrix[1])) * extents.y + glm::abs(glm::vec3(matrix[2])) * extents.z;
+	min = center - transformedExtents;
+	max = center + transformedExtents;
+}
+
 /*
 	glTF mesh
 */
@@ -500,8 +721,10 @@ vkglTF::Mesh::Mesh(vks::VulkanDevice *device, glm::mat4 matrix) {
 };
 
 vkglTF::Mesh::~Mesh() {
-	vkDestroyBuffer(device->logicalDevice, uniformBuffer.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, uniformBuffer.memory, nullptr);
+	if (uniformBuffer.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->logicalDevice, uniformBuffer.buffer, nullptr);
+		vkFreeMemory(device->logicalDevice, uniformBuffer.memory, nullptr);
+	}
     for(auto primitive : primitives)
     {
         delete primitive;
@@ -511,11 +734,42 @@ vkglTF::Mesh::~Mesh() {
 /*
 	glTF node
 */
+void vkglTF::Node::setTranslation(const glm::vec3& translation) {
+	if (hierarchy) {
+		hierarchy->setTranslation(hierarchyIndex, translation);
+	} else {
+		this->translation = translation;
+	}
+}
+
+void vkglTF::Node::setRotation(const glm::quat& rotation) {
+	if (hierarchy) {
+		hierarchy->setRotation(hierarchyIndex, rotation);
+	} else {
+		this->rotation = rotation;
+	}
+}
+
+void vkglTF::Node::setScale(const glm::vec3& scale) {
+	if (hierarchy) {
+		hierarchy->setScale(hierarchyIndex, scale);
+	} else {
+		this->scale = scale;
+	}
+}
+
 glm::mat4 vkglTF::Node::localMatrix() {
+	if (hierarchy) {
+		return hierarchy->localMatrices[hierarchyIndex];
+	}
 	return glm::translate(glm::mat4(1.0f), translation) * glm::mat4(rotation) * glm::scale(glm::mat4(1.0f), scale) * matrix;
 }
 
+// Nodes that are part of a hierarchy return the world matrix calculated by the last TransformHierarchy::update
 glm::mat4 vkglTF::Node::getMatrix() {
+	if (hierarchy) {
+		return hierarchy->worldMatrices[hierarchyIndex];
+	}
 	glm::mat4 m = localMatrix();
 	vkglTF::Node *p = parent;
 	while (p) {
@@ -525,31 +779,178 @@ glm::mat4 vkglTF::Node::getMatrix() {
 	return m;
 }
 
-void vkglTF::Node::update() {
+/*
+	Updates the mesh's uniform buffer and, for skinned meshes, its joint matrices in the model's joint palette
+	Within a hierarchy, only joints whose world matrix changed are recalculated unless the mesh node itself moved
+*/
+void vkglTF::Node::updateMesh() {
 	if (mesh) {
 		glm::mat4 m = getMatrix();
-		if (skin) {
-			mesh->uniformBlock.matrix = m;
-			// Update join matrices
+		mesh->uniformBlock.matrix = m;
+		memcpy(mesh->uniformBuffer.mapped, &m, sizeof(glm::mat4));
+		if (skin && mesh->jointPalette && (mesh->uniformBlock.jointCount > 0)) {
+			JointPalette* palette = mesh->jointPalette;
+			const bool allJoints = !hierarchy || hierarchy->changed[hierarchyIndex];
 			glm::mat4 inverseTransform = glm::inverse(m);
-			for (size_t i = 0; i < skin->joints.size(); i++) {
+			const uint32_t jointOffset = mesh->uniformBlock.jointOffset;
+			const uint32_t jointCount = mesh->uniformBlock.jointCount;
+			for (uint32_t i = 0; i < jointCount; i++) {
 				vkglTF::Node *jointNode = skin->joints[i];
-				glm::mat4 jointMat = jointNode->getMatrix() * skin->inverseBindMatrices[i];
-				jointMat = inverseTransform * jointMat;
-				mesh->uniformBlock.jointMatrix[i] = jointMat;
+				if (!allJoints && !hierarchy->changed[jointNode->hierarchyIndex]) {
+					continue;
+				}
+				palette->matrices[jointOffset + i] = inverseTransform * jointNode->getMatrix() * skin->inverseBindMatrices[i];
+				palette->markDirty(jointOffset + i, 1);
 			}
-			mesh->uniformBlock.jointcount = (float)skin->joints.size();
-			memcpy(mesh->uniformBuffer.mapped, &mesh->uniformBlock, sizeof(mesh->uniformBlock));
-		} else {
-			memcpy(mesh->uniformBuffer.mapped, &m, sizeof(glm::mat4));
 		}
 	}
+}
 
+void vkglTF::Node::update() {
+	updateMesh();
 	for (auto& child : children) {
 		child->update();
 	}
 }
 
+/*
+	glTF joint palette
+*/
+void vkglTF::JointPalette::create(vks::VulkanDevice* device, uint32_t jointCount)
+{
+	this->device = device;
+	matrices.assign(jointCount, glm::mat4(1.0f));
+	// Always create a buffer, so the node descriptor sets of models without skins are valid too
+	const VkDeviceSize bufferSize = std::max(jointCount, 1u) * sizeof(glm::mat4);
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		bufferSize,
+		&buffer,
+		&memory));
+	VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, memory, 0, bufferSize, 0, &mapped));
+	descriptor = { buffer, 0, bufferSize };
+	markDirty(0, jointCount);
+}
+
+void vkglTF::JointPalette::markDirty(uint32_t first, uint32_t count)
+{
+	if (count == 0) {
+		return;
+	}
+	dirtyBegin = std::min(dirtyBegin, first);
+	dirtyEnd = std::max(dirtyEnd, first + count);
+}
+
+// Copies the matrices changed since the last upload to the buffer
+void vkglTF::JointPalette::upload()
+{
+	if ((dirtyBegin >= dirtyEnd) || !mapped) {
+		return;
+	}
+	memcpy(static_cast<glm::mat4*>(mapped) + dirtyBegin, &matrices[dirtyBegin], (dirtyEnd - dirtyBegin) * sizeof(glm::mat4));
+	dirtyBegin = UINT32_MAX;
+	dirtyEnd = 0;
+}
+
+void vkglTF::JointPalette::destroy()
+{
+	if (buffer != VK_NULL_HANDLE) {
+		vkUnmapMemory(device->logicalDevice, memory);
+		vkDestroyBuffer(device->logicalDevice, buffer, nullptr);
+		vkFreeMemory(device->logicalDevice, memory, nullptr);
+		buffer = VK_NULL_HANDLE;
+		memory = VK_NULL_HANDLE;
+		mapped = nullptr;
+	}
+}
+
+/*
+	glTF node transform hierarchy
+*/
+void vkglTF::TransformHierarchy::build(const std::vector<Node*>& rootNodes)
+{
+	nodes.clear();
+	parents.clear();
+	// Depth first pre-order keeps parents before their children and subtrees close together
+	std::vector<std::pair<Node*, int32_t>> stack;
+	for (auto it = rootNodes.rbegin(); it != rootNodes.rend(); ++it) {
+		stack.push_back({ *it, -1 });
+	}
+	while (!stack.empty()) {
+		Node* node = stack.back().first;
+		const int32_t parent = stack.back().second;
+		stack.pop_back();
+		const int32_t index = static_cast<int32_t>(nodes.size());
+		nodes.push_back(node);
+		parents.push_back(parent);
+		for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+			stack.push_back({ *it, index });
+		}
+	}
+
+	const size_t count = nodes.size();
+	translations.resize(count);
+	rotations.resize(count);
+	scales.resize(count);
+	matrices.resize(count);
+	localMatrices.resize(count);
+	worldMatrices.resize(count);
+	dirty.assign(count, 1);
+	changed.assign(count, 0);
+	for (size_t i = 0; i < count; i++) {
+		Node* node = nodes[i];
+		translations[i] = node->translation;
+		rotations[i] = node->rotation;
+		scales[i] = node->scale;
+		matrices[i] = node->matrix;
+		node->hierarchy = this;
+		node->hierarchyIndex = static_cast<uint32_t>(i);
+	}
+}
+
+void vkglTF::TransformHierarchy::setTranslation(uint32_t index, const glm::vec3& translation)
+{
+	translations[index] = translation;
+	dirty[index] = 1;
+}
+
+void vkglTF::TransformHierarchy::setRotation(uint32_t index, const glm::quat& rotation)
+{
+	rotations[index] = rotation;
+	dirty[index] = 1;
+}
+
+void vkglTF::TransformHierarchy::setScale(uint32_t index, const glm::vec3& scale)
+{
+	scales[index] = scale;
+	dirty[index] = 1;
+}
+
+/*
+	Recalculates the local matrices of all dirty nodes and the world matrices of these and their descendants, returns true if any world matrix changed
+*/
+bool vkglTF::TransformHierarchy::update()
+{
+	bool anyChanged = false;
+	const size_t count = nodes.size();
+	for (size_t i = 0; i < count; i++) {
+		const int32_t parent = parents[i];
+		const bool parentChanged = (parent >= 0) && changed[parent];
+		const bool localChanged = dirty[i] != 0;
+		if (localChanged) {
+			localMatrices[i] = glm::translate(glm::mat4(1.0f), translations[i]) * glm::mat4(rotations[i]) * glm::scale(glm::mat4(1.0f), scales[i]) * matrices[i];
+			dirty[i] = 0;
+		}
+		if (localChanged || parentChanged) {
+			worldMatrices[i] = (parent >= 0) ? worldMatrices[parent] * localMatrices[i] : localMatrices[i];
+			anyChanged = true;
+		}
+		changed[i] = (localChanged || parentChanged) ? 1 : 0;
+	}
+	return anyChanged;
+}
+
 vkglTF::Node::~Node() {
 	if (mesh) {
 		delete mesh;
@@ -559,6 +960,237 @@ vkglTF::Node::~Node() {
 	}
 }
 
+/*
+	glTF primitive bounding volume hierarchy
+*/
+static float surfaceArea(const glm::vec3& min, const glm::vec3& max)
+{
+	const glm::vec3 d = max - min;
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+void vkglTF::BoundingVolumeHierarchy::build(const std::vector<Node*>& sceneNodes, bool preTransformed)
+{
+	this->preTransformed = preTransformed;
+	nodes.clear();
+	items.clear();
+	unboundedItems.clear();
+	for (Node* node : sceneNodes) {
+		if (!node->mesh) {
+			continue;
+		}
+		for (Primitive* primitive : node->mesh->primitives) {
+			Item item{ node, primitive, glm::vec3(0.0f), glm::vec3(0.0f) };
+			if (node->skin || !primitive->morphTargets.empty()) {
+				unboundedItems.push_back(item);
+				continue;
+			}
+			updateItemBounds(item);
+			items.push_back(item);
+		}
+	}
+	itemLeaves.assign(items.size(), 0);
+	if (items.empty()) {
+		return;
+	}
+	// A binary tree with single item leaves has at most 2n - 1 nodes
+	nodes.reserve(items.size() * 2);
+	nodes.push_back(TreeNode{});
+	split(0, 0, static_cast<uint32_t>(items.size()));
+	dirtyNodes.assign(nodes.size(), 0);
+}
+
+void vkglTF::BoundingVolumeHierarchy::updateItemBounds(Item& item) const
+{
+	item.primitive->getBounds(preTransformed ? glm::mat4(1.0f) : item.node->getMatrix(), item.min, item.max);
+}
+
+void vkglTF::BoundingVolumeHierarchy::updateNodeBounds(uint32_t index)
+{
+	TreeNode& node = nodes[index];
+	if (node.children != 0) {
+		node.min = glm::min(nodes[node.children].min, nodes[node.children + 1].min);
+		node.max = glm::max(nodes[node.children].max, nodes[node.children + 1].max);
+		return;
+	}
+	node.min = glm::vec3(FLT_MAX);
+	node.max = glm::vec3(-FLT_MAX);
+	for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+		node.min = glm::min(node.min, items[i].min);
+		node.max = glm::max(node.max, items[i].max);
+	}
+}
+
+// Splits the items of a node along the axis with the largest centroid extent at the cheapest of the binned SAH candidates
+void vkglTF::BoundingVolumeHierarchy::split(uint32_t index, uint32_t firstItem, uint32_t itemCount)
+{
+	const uint32_t maxLeafItems = 4;
+	const uint32_t binCount = 16;
+
+	nodes[index].firstItem = firstItem;
+	nodes[index].itemCount = itemCount;
+	nodes[index].children = 0;
+	updateNodeBounds(index);
+
+	glm::vec3 centroidMin(FLT_MAX);
+	glm::vec3 centroidMax(-FLT_MAX);
+	for (uint32_t i = firstItem; i < firstItem + itemCount; i++) {
+		const glm::vec3 centroid = (items[i].min + items[i].max) * 0.5f;
+		centroidMin = glm::min(centroidMin, centroid);
+		centroidMax = glm::max(centroidMax, centroid);
+	}
+	const glm::vec3 centroidExtent = centroidMax - centroidMin;
+	int axis = 0;
+	if (centroidExtent.y > centroidExtent[axis]) {
+		axis = 1;
+	}
+	if (centroidExtent.z > centroidExtent[axis]) {
+		axis = 2;
+	}
+	// Items with identical centroids can't be separated
+	if ((itemCount <= maxLeafItems) || (centroidExtent[axis] <= 0.0f)) {
+		for (uint32_t i = firstItem; i < firstItem + itemCount; i++) {
+			itemLeaves[i] = index;
+		}
+		return;
+	}
+
+	struct Bin {
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+		uint32_t count = 0;
+	};
+	std::array<Bin, binCount> bins;
+	const float binScale = binCount / centroidExtent[axis];
+	auto binIndex = [&](const Item& item) {
+		const float centroid = (item.min[axis] + item.max[axis]) * 0.5f;
+		return std::min(static_cast<uint32_t>((centroid - centroidMin[axis]) * binScale), binCount - 1);
+	};
+	for (uint32_t i = firstItem; i < firstItem + itemCount; i++) {
+		Bin& bin = bins[binIndex(items[i])];
+		bin.min = glm::min(bin.min, items[i].min);
+		bin.max = glm::max(bin.max, items[i].max);
+		bin.count++;
+	}
+	// Sweep from the right to get the cost of everything right of each split, then from the left to find the cheapest split
+	std::array<float, binCount> rightCosts{};
+	Bin accumulated;
+	for (uint32_t b = binCount - 1; b > 0; b--) {
+		accumulated.min = glm::min(accumulated.min, bins[b].min);
+		accumulated.max = glm::max(accumulated.max, bins[b].max);
+		accumulated.count += bins[b].count;
+		rightCosts[b] = (accumulated.count > 0) ? surfaceArea(accumulated.min, accumulated.max) * accumulated.count : 0.0f;
+	}
+	accumulated = Bin();
+	uint32_t bestSplit = 0;
+	float bestCost = FLT_MAX;
+	for (uint32_t b = 1; b < binCount; b++) {
+		accumulated.min = glm::min(accumulated.min, bins[b - 1].min);
+		accumulated.max = glm::max(accumulated.max, bins[b - 1].max);
+		accumulated.count += bins[b - 1].count;
+		if ((accumulated.count == 0) || (accumulated.count == itemCount)) {
+			continue;
+		}
+		const float cost = surfaceArea(accumulated.min, accumulated.max) * accumulated.count + rightCosts[b];
+		if (cost < bestCost) {
+			bestCost = cost;
+			bestSplit = b;
+		}
+	}
+
+	uint32_t leftCount = 0;
+	if (bestSplit > 0) {
+		auto middle = std::partition(items.begin() + firstItem, items.begin() + firstItem + itemCount, [&](const Item& item) { return binIndex(item) < bestSplit; });
+		leftCount = static_cast<uint32_t>(std::distance(items.begin() + firstItem, middle));
+	} else {
+		// All centroids ended up in one bin, fall back to a median split
+		leftCount = itemCount / 2;
+		std::nth_element(items.begin() + firstItem, items.begin() + firstItem + leftCount, items.begin() + firstItem + itemCount, [&](const Item& a, const Item& b) {
+			return (a.min[axis] + a.max[axis]) < (b.min[axis] + b.max[axis]);
+		});
+	}
+
+	const uint32_t children = static_cast<uint32_t>(nodes.size());
+	nodes[index].children = children;
+	nodes.push_back(TreeNode{});
+	nodes.push_back(TreeNode{});
+	nodes[children].parent = index;
+	nodes[children + 1].parent = index;
+	split(children, firstItem, leftCount);
+	split(children + 1, firstItem + leftCount, itemCount - leftCount);
+}
+
+/*
+	Updates the bounds of all items whose node's world matrix changed in the last TransformHierarchy::update and of their ancestors
+*/
+void vkglTF::BoundingVolumeHierarchy::refit(const TransformHierarchy& transforms)
+{
+	if (preTransformed || nodes.empty()) {
+		return;
+	}
+	refitNodes.clear();
+	for (size_t i = 0; i < items.size(); i++) {
+		if (!transforms.changed[items[i].node->hierarchyIndex]) {
+			continue;
+		}
+		updateItemBounds(items[i]);
+		// Mark the path to the root, stopping at the first node already marked by another item
+		uint32_t index = itemLeaves[i];
+		while (!dirtyNodes[index]) {
+			dirtyNodes[index] = 1;
+			refitNodes.push_back(index);
+			if (index == 0) {
+				break;
+			}
+			index = nodes[index].parent;
+		}
+	}
+	// Children are always stored after their parents, so refitting from the back updates children first
+	std::sort(refitNodes.begin(), refitNodes.end(), std::greater<uint32_t>());
+	for (uint32_t index : refitNodes) {
+		updateNodeBounds(index);
+		dirtyNodes[index] = 0;
+	}
+}
+
+/*
+	Collects the items whose bounds intersect the frustum, subtrees are skipped as soon as their bounds are outside of it
+	and planes that fully contain a subtree are not tested again for its descendants
+*/
+uint32_t vkglTF::BoundingVolumeHierarchy::query(const vks::Frustum& frustum, std::vector<uint32_t>& visibility)
+{
+	visibility.assign((items.size() + 31) / 32, 0u);
+	if (nodes.empty()) {
+		return 0;
+	}
+	uint32_t visibleCount = 0;
+	traversalStack.clear();
+	traversalStack.push_back(std::make_pair(0u, static_cast<uint8_t>(vks::Frustum::ALL_PLANES)));
+	while (!traversalStack.empty()) {
+		const uint32_t index = traversalStack.back().first;
+		uint8_t planeMask = traversalStack.back().second;
+		traversalStack.pop_back();
+		const TreeNode& node = nodes[index];
+		if ((planeMask != 0) && !frustum.checkBox(node.min, node.max, planeMask)) {
+			continue;
+		}
+		if ((node.children != 0) && (planeMask != 0)) {
+			traversalStack.push_back(std::make_pair(node.children + 1, planeMask));
+			traversalStack.push_back(std::make_pair(node.children, planeMask));
+			continue;
+		}
+		// Leaf or subtree fully inside, only items of partially visible leaves need to be tested
+		for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+			uint8_t itemMask = planeMask;
+			if ((itemMask == 0) || frustum.checkBox(items[i].min, items[i].max, itemMask)) {
+				visibility[i / 32] |= 1u << (i % 32);
+				visibleCount++;
+			}
+		}
+	}
+	return visibleCount;
+}
+
 /*
 	glTF default vertex layout with easy Vulkan mapping functions
 */
@@ -614,51 +1246,170 @@ VkPipelineVertexInputStateCreateInfo* vkglTF::Vertex::getPipelineVertexInputStat
 	return &pipelineVertexInputStateCreateInfo;
 }
 
-vkglTF::Texture* vkglTF::Model::getTexture(uint32_t index)
-{
+/*
+	glTF packed vertex layout
+*/
 
-	if (index < textures.size()) {
-		return &textures[index];
+std::vector<vkglTF::VertexComponent> vkglTF::packedVertexComponents = { vkglTF::VertexComponent::Position, vkglTF::VertexComponent::Normal, vkglTF::VertexComponent::UV };
+float vkglTF::vertexWeldEpsilon = 0.0f;
+VkVertexInputBindingDescription vkglTF::PackedVertex::vertexInputBindingDescription;
+std::vector<VkVertexInputAttributeDescription> vkglTF::PackedVertex::vertexInputAttributeDescriptions;
+VkPipelineVertexInputStateCreateInfo vkglTF::PackedVertex::pipelineVertexInputStateCreateInfo;
+
+// Octahedral encoding of a unit vector into [-1..1]^2
+static glm::vec2 octahedralEncode(glm::vec3 n)
+{
+	n /= (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+	glm::vec2 oct(n.x, n.y);
+	if (n.z < 0.0f) {
+		oct.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+		oct.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
 	}
-	return nullptr;
+	return oct;
 }
 
-void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
-{
-	emptyTexture.device = device;
-	emptyTexture.width = 1;
-	emptyTexture.height = 1;
-	emptyTexture.layerCount = 1;
-	emptyTexture.mipLevels = 1;
+uint32_t vkglTF::PackedVertex::componentSize(VertexComponent component) {
+	switch (component) {
+		case VertexComponent::Position:
+			return 12;
+		case VertexComponent::Tangent:
+			return 8;
+		default:
+			return 4;
+	}
+}
+
+uint32_t vkglTF::PackedVertex::stride(const std::vector<VertexComponent>& components) {
+	uint32_t result = 0;
+	for (VertexComponent component : components) {
+		result += componentSize(component);
+	}
+	return result;
+}
+
+void vkglTF::PackedVertex::pack(const Vertex& vertex, const std::vector<VertexComponent>& components, uint8_t* dst) {
+	for (VertexComponent component : components) {
+		uint32_t packed[3] = { 0, 0, 0 };
+		switch (component) {
+			case VertexComponent::Position:
+				memcpy(packed, &vertex.pos, sizeof(glm::vec3));
+				break;
+			case VertexComponent::Normal:
+				packed[0] = glm::packSnorm2x16(octahedralEncode(vertex.normal));
+				break;
+			case VertexComponent::UV:
+				packed[0] = glm::packHalf2x16(vertex.uv);
+				break;
+			case VertexComponent::Color:
+				packed[0] = glm::packUnorm4x8(glm::clamp(vertex.color, 0.0f, 1.0f));
+				break;
+			case VertexComponent::Tangent:
+				// Tangents without a valid direction (not present in the file) fall back to +X
+				packed[0] = glm::packSnorm2x16(glm::dot(glm::vec3(vertex.tangent), glm::vec3(vertex.tangent)) > 0.0f ? octahedralEncode(glm::vec3(vertex.tangent)) : glm::vec2(1.0f, 0.0f));
+				packed[1] = glm::packSnorm2x16(glm::vec2(vertex.tangent.w < 0.0f ? -1.0f : 1.0f, 0.0f));
+				break;
+			case VertexComponent::Joint0:
+				// Models with joint indices above 255 are loaded with the default layout instead (see loadFromFile)
+				assert(glm::max(glm::max(vertex.joint0.x, vertex.joint0.y), glm::max(vertex.joint0.z, vertex.joint0.w)) < 256.0f);
+				packed[0] = uint32_t(vertex.joint0.x) | (uint32_t(vertex.joint0.y) << 8) | (uint32_t(vertex.joint0.z) << 16) | (uint32_t(vertex.joint0.w) << 24);
+				break;
+			case VertexComponent::Weight0:
+				packed[0] = glm::packUnorm4x8(vertex.weight0);
+				break;
+			default:
+				// Unknown components are written as zeros
+				assert(false);
+				break;
+		}
+		memcpy(dst, packed, componentSize(component));
+		dst += componentSize(component);
+	}
+}
+
+VkVertexInputBindingDescription vkglTF::PackedVertex::inputBindingDescription(uint32_t binding, const std::vector<VertexComponent>& components) {
+	return VkVertexInputBindingDescription({ binding, stride(components), VK_VERTEX_INPUT_RATE_VERTEX });
+}
+
+std::vector<VkVertexInputAttributeDescription> vkglTF::PackedVertex::inputAttributeDescriptions(uint32_t binding, const std::vector<VertexComponent> components) {
+	std::vector<VkVertexInputAttributeDescription> result;
+	uint32_t location = 0;
+	uint32_t offset = 0;
+	for (VertexComponent component : components) {
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		switch (component) {
+			case VertexComponent::Position:
+				format = VK_FORMAT_R32G32B32_SFLOAT;
+				break;
+			case VertexComponent::Normal:
+				format = VK_FORMAT_R16G16_SNORM;
+				break;
+			case VertexComponent::UV:
+				format = VK_FORMAT_R16G16_SFLOAT;
+				break;
+			case VertexComponent::Color:
+				format = VK_FORMAT_R8G8B8A8_UNORM;
+				break;
+			case VertexComponent::Tangent:
+				format = VK_FORMAT_R16G16B16A16_SNORM;
+				break;
+			case VertexComponent::Joint0:
+				format = VK_FORMAT_R8G8B8A8_UINT;
+				break;
+			case VertexComponent::Weight0:
+				format = VK_FORMAT_R8G8B8A8_UNORM;
+				break;
+		}
+		result.push_back(VkVertexInputAttributeDescription({ location, binding, format, offset }));
+		offset += componentSize(component);
+		location++;
+	}
+	return result;
+}
+
+VkPipelineVertexInputStateCreateInfo* vkglTF::PackedVertex::getPipelineVertexInputState(const std::vector<VertexComponent> components) {
+	vertexInputBindingDescription = PackedVertex::inputBindingDescription(0, components);
+	PackedVertex::vertexInputAttributeDescriptions = PackedVertex::inputAttributeDescriptions(0, components);
+	pipelineVertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	pipelineVertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
+	pipelineVertexInputStateCreateInfo.pVertexBindingDescriptions = &PackedVertex::vertexInputBindingDescription;
+	pipelineVertexInputStateCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(PackedVertex::vertexInputAttributeDescriptions.size());
+	pipelineVertexInputStateCreateInfo.pVertexAttributeDescriptions = PackedVertex::vertexInputAttributeDescriptions.data();
+	return &pipelineVertexInputStateCreateInfo;
+}
+
+vkglTF::Texture* vkglTF::Model::getTexture(uint32_t index)
+{
+
+	if (index < textures.size()) {
+		return &textures[index];
+	}
+	return nullptr;
+}
+
+void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
+{
+	emptyTexture.device = device;
+	emptyTexture.width = 1;
+	emptyTexture.height = 1;
+	emptyTexture.layerCount = 1;
+	emptyTexture.mipLevels = 1;
 
 	size_t bufferSize = emptyTexture.width * emptyTexture.height * 4;
 	unsigned char* buffer = new unsigned char[bufferSize];
 	memset(buffer, 0, bufferSize);
 
+	VkCommandBuffer copyCmd = device->beginUploadBatch(transferQueue);
+
+	// Copy texture data into the upload batch's staging ring
 	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMemory;
-	VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-	bufferCreateInfo.size = bufferSize;
-	// This buffer is used as a transfer source for the buffer copy
-	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
+	VkDeviceSize stagingOffset = device->stageUploadData(buffer, bufferSize, &stagingBuffer);
+	delete[] buffer;
 
 	VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
 	VkMemoryRequirements memReqs;
-	vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-	memAllocInfo.allocationSize = memReqs.size;
-	memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-	VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-	// Copy texture data into staging buffer
-	uint8_t* data;
-	VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-	memcpy(data, buffer, bufferSize);
-	vkUnmapMemory(device->logicalDevice, stagingMemory);
 
 	VkBufferImageCopy bufferCopyRegion = {};
+	bufferCopyRegion.bufferOffset = stagingOffset;
 	bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	bufferCopyRegion.imageSubresource.layerCount = 1;
 	bufferCopyRegion.imageExtent.width = emptyTexture.width;
@@ -691,17 +1442,12 @@ void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 	subresourceRange.levelCount = 1;
 	subresourceRange.layerCount = 1;
 
-	VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
 	vks::tools::setImageLayout(copyCmd, emptyTexture.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
 	vkCmdCopyBufferToImage(copyCmd, stagingBuffer, emptyTexture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
 	vks::tools::setImageLayout(copyCmd, emptyTexture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-	device->flushCommandBuffer(copyCmd, transferQueue);
+	device->endUploadBatch();
 	emptyTexture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-	// Clean up staging resources
-	vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-	vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-
 	VkSamplerCreateInfo samplerCreateInfo = vks::initializers::samplerCreateInfo();
 	samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
 	samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
@@ -731,16 +1477,31 @@ void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 */
 vkglTF::Model::~Model()
 {
-	vkDestroyBuffer(device->logicalDevice, vertices.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, vertices.memory, nullptr);
-	vkDestroyBuffer(device->logicalDevice, indices.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, indices.memory, nullptr);
+	// Vulkan objects are only destroyed if they were created, models that only hold a node hierarchy (e.g. the nodelookup benchmark) have none
+	if (vertices.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->logicalDevice, vertices.buffer, nullptr);
+		vkFreeMemory(device->logicalDevice, vertices.memory, nullptr);
+	}
+	if (indices.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->logicalDevice, indices.buffer, nullptr);
+		vkFreeMemory(device->logicalDevice, indices.memory, nullptr);
+	}
+	if (positions.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->logicalDevice, positions.buffer, nullptr);
+		vkFreeMemory(device->logicalDevice, positions.memory, nullptr);
+	}
 	for (auto texture : textures) {
 		texture.destroy();
 	}
 	for (auto node : nodes) {
 		delete node;
 	}
+	jointPalette.destroy();
+	for (MorphTargets::Frame& frame : morphTargets.frames) {
+		vkUnmapMemory(device->logicalDevice, frame.memory);
+		vkDestroyBuffer(device->logicalDevice, frame.buffer, nullptr);
+		vkFreeMemory(device->logicalDevice, frame.memory, nullptr);
+	}
     for (auto skin : skins) {
         delete skin;
     }
@@ -752,10 +1513,55 @@ vkglTF::Model::~Model()
 		vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayoutImage, nullptr);
 		descriptorSetLayoutImage = VK_NULL_HANDLE;
 	}
-	vkDestroyDescriptorPool(device->logicalDevice, descriptorPool, nullptr);
+	if (descriptorPool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(device->logicalDevice, descriptorPool, nullptr);
+	}
 	emptyTexture.destroy();
 }
 
+// Returns a pointer to the first element of an accessor, taken from the buffer data set up by loadFromFile
+const unsigned char* vkglTF::Model::getAccessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor) const
+{
+	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+	return bufferData[bufferView.buffer] + bufferView.byteOffset + accessor.byteOffset;
+}
+
+// Reads a float3 accessor, including sparse accessors (commonly used for morph targets) with or without a base buffer view
+void vkglTF::Model::getAccessorVec3(const tinygltf::Model& model, const tinygltf::Accessor& accessor, std::vector<glm::vec3>& values) const
+{
+	assert((accessor.type == TINYGLTF_TYPE_VEC3) && (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT));
+	if (accessor.bufferView > -1) {
+		const glm::vec3* data = reinterpret_cast<const glm::vec3*>(getAccessorData(model, accessor));
+		values.assign(data, data + accessor.count);
+	} else {
+		values.assign(accessor.count, glm::vec3(0.0f));
+	}
+	if (!accessor.sparse.isSparse) {
+		return;
+	}
+	const tinygltf::BufferView& indexView = model.bufferViews[accessor.sparse.indices.bufferView];
+	const tinygltf::BufferView& valueView = model.bufferViews[accessor.sparse.values.bufferView];
+	const unsigned char* indexData = bufferData[indexView.buffer] + indexView.byteOffset + accessor.sparse.indices.byteOffset;
+	const glm::vec3* valueData = reinterpret_cast<const glm::vec3*>(bufferData[valueView.buffer] + valueView.byteOffset + accessor.sparse.values.byteOffset);
+	for (int i = 0; i < accessor.sparse.count; i++) {
+		uint32_t index = 0;
+		switch (accessor.sparse.indices.componentType) {
+		case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+			index = reinterpret_cast<const uint32_t*>(indexData)[i];
+			break;
+		case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+			index = reinterpret_cast<const uint16_t*>(indexData)[i];
+			break;
+		default:
+			index = indexData[i];
+			break;
+		}
+		if (index < values.size()) {
+			values[index] = valueData[i];
+		}
+	}
+}
+
 void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, uint32_t nodeIndex, const tinygltf::Model &model, std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer, float globalscale)
 {
 	vkglTF::Node *newNode = new Node{};
@@ -764,6 +1570,10 @@ void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, u
 	newNode->name = node.name;
 	newNode->skinIndex = node.skin;
 	newNode->matrix = glm::mat4(1.0f);
+	if (nodeIndex >= nodeTable.size()) {
+		nodeTable.resize(nodeIndex + 1, nullptr);
+	}
+	nodeTable[nodeIndex] = newNode;
 
 	// Generate local node matrix
 	glm::vec3 translation = glm::vec3(0.0f);
@@ -827,51 +1637,44 @@ void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, u
 				assert(primitive.attributes.find("POSITION") != primitive.attributes.end());
 
 				const tinygltf::Accessor &posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
-				const tinygltf::BufferView &posView = model.bufferViews[posAccessor.bufferView];
-				bufferPos = reinterpret_cast<const float *>(&(model.buffers[posView.buffer].data[posAccessor.byteOffset + posView.byteOffset]));
+				bufferPos = reinterpret_cast<const float *>(getAccessorData(model, posAccessor));
 				posMin = glm::vec3(posAccessor.minValues[0], posAccessor.minValues[1], posAccessor.minValues[2]);
 				posMax = glm::vec3(posAccessor.maxValues[0], posAccessor.maxValues[1], posAccessor.maxValues[2]);
 
 				if (primitive.attributes.find("NORMAL") != primitive.attributes.end()) {
 					const tinygltf::Accessor &normAccessor = model.accessors[primitive.attributes.find("NORMAL")->second];
-					const tinygltf::BufferView &normView = model.bufferViews[normAccessor.bufferView];
-					bufferNormals = reinterpret_cast<const float *>(&(model.buffers[normView.buffer].data[normAccessor.byteOffset + normView.byteOffset]));
+					bufferNormals = reinterpret_cast<const float *>(getAccessorData(model, normAccessor));
 				}
 
 				if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end()) {
 					const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
-					const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-					bufferTexCoords = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+					bufferTexCoords = reinterpret_cast<const float *>(getAccessorData(model, uvAccessor));
 				}
 
 				if (primitive.attributes.find("COLOR_0") != primitive.attributes.end())
 				{
 					const tinygltf::Accessor& colorAccessor = model.accessors[primitive.attributes.find("COLOR_0")->second];
-					const tinygltf::BufferView& colorView = model.bufferViews[colorAccessor.bufferView];
 					// Color buffer are either of type vec3 or vec4
 					numColorComponents = colorAccessor.type == TINYGLTF_PARAMETER_TYPE_FLOAT_VEC3 ? 3 : 4;
-					bufferColors = reinterpret_cast<const float*>(&(model.buffers[colorView.buffer].data[colorAccessor.byteOffset + colorView.byteOffset]));
+					bufferColors = reinterpret_cast<const float *>(getAccessorData(model, colorAccessor));
 				}
 
 				if (primitive.attributes.find("TANGENT") != primitive.attributes.end())
 				{
 					const tinygltf::Accessor &tangentAccessor = model.accessors[primitive.attributes.find("TANGENT")->second];
-					const tinygltf::BufferView &tangentView = model.bufferViews[tangentAccessor.bufferView];
-					bufferTangents = reinterpret_cast<const float *>(&(model.buffers[tangentView.buffer].data[tangentAccessor.byteOffset + tangentView.byteOffset]));
+					bufferTangents = reinterpret_cast<const float *>(getAccessorData(model, tangentAccessor));
 				}
 
 				// Skinning
 				// Joints
 				if (primitive.attributes.find("JOINTS_0") != primitive.attributes.end()) {
 					const tinygltf::Accessor &jointAccessor = model.accessors[primitive.attributes.find("JOINTS_0")->second];
-					const tinygltf::BufferView &jointView = model.bufferViews[jointAccessor.bufferView];
-					bufferJoints = reinterpret_cast<const uint16_t *>(&(model.buffers[jointView.buffer].data[jointAccessor.byteOffset + jointView.byteOffset]));
+					bufferJoints = reinterpret_cast<const uint16_t *>(getAccessorData(model, jointAccessor));
 				}
 
 				if (primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end()) {
 					const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("WEIGHTS_0")->second];
-					const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-					bufferWeights = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+					bufferWeights = reinterpret_cast<const float *>(getAccessorData(model, uvAccessor));
 				}
 
 				hasSkin = (bufferJoints && bufferWeights);
@@ -903,38 +1706,32 @@ void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, u
 			// Indices
 			{
 				const tinygltf::Accessor &accessor = model.accessors[primitive.indices];
-				const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+				// glTF requires accessor offsets to be aligned to the component size, so indices can be read in place
+				const unsigned char *data = getAccessorData(model, accessor);
 
 				indexCount = static_cast<uint32_t>(accessor.count);
 
 				switch (accessor.componentType) {
 				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-					uint32_t *buf = new uint32_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint32_t));
+					const uint32_t *buf = reinterpret_cast<const uint32_t *>(data);
 					for (size_t index = 0; index < accessor.count; index++) {
 						indexBuffer.push_back(buf[index] + vertexStart);
 					}
-                    delete[] buf;
 					break;
 				}
 				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-					uint16_t *buf = new uint16_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint16_t));
+					const uint16_t *buf = reinterpret_cast<const uint16_t *>(data);
 					for (size_t index = 0; index < accessor.count; index++) {
 						indexBuffer.push_back(buf[index] + vertexStart);
 					}
-                    delete[] buf;
-                    break;
+					break;
 				}
 				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-					uint8_t *buf = new uint8_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint8_t));
+					const uint8_t *buf = reinterpret_cast<const uint8_t *>(data);
 					for (size_t index = 0; index < accessor.count; index++) {
 						indexBuffer.push_back(buf[index] + vertexStart);
 					}
-                    delete[] buf;
-                    break;
+					break;
 				}
 				default:
 					std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl;
@@ -945,8 +1742,49 @@ void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, u
 			newPrimitive->firstVertex = vertexStart;
 			newPrimitive->vertexCount = vertexCount;
 			newPrimitive->setDimensions(posMin, posMax);
+			// Morph targets, only vertices moved by a target are stored
+			if (morphTargetsEnabled) {
+				std::vector<glm::vec3> targetData[3];
+				const char* targetAttributes[3] = { "POSITION", "NORMAL", "TANGENT" };
+				for (const auto& target : primitive.targets) {
+					for (uint32_t a = 0; a < 3; a++) {
+						auto attribute = target.find(targetAttributes[a]);
+						if (attribute != target.end()) {
+							getAccessorVec3(model, model.accessors[attribute->second], targetData[a]);
+							targetData[a].resize(vertexCount, glm::vec3(0.0f));
+						} else {
+							targetData[a].assign(vertexCount, glm::vec3(0.0f));
+						}
+					}
+					MorphTarget morphTarget{};
+					morphTarget.firstDelta = static_cast<uint32_t>(morphTargets.deltas.size());
+					for (uint32_t v = 0; v < vertexCount; v++) {
+						if ((targetData[0][v] == glm::vec3(0.0f)) && (targetData[1][v] == glm::vec3(0.0f)) && (targetData[2][v] == glm::vec3(0.0f))) {
+							continue;
+						}
+						MorphTargets::Delta delta{};
+						delta.vertex = v;
+						delta.position = targetData[0][v];
+						delta.normal = targetData[1][v];
+						delta.tangent = targetData[2][v];
+						morphTargets.deltas.push_back(delta);
+					}
+					morphTarget.deltaCount = static_cast<uint32_t>(morphTargets.deltas.size()) - morphTarget.firstDelta;
+					newPrimitive->morphTargets.push_back(morphTarget);
+				}
+				if (newPrimitive->morphTargets.size() > newMesh->weights.size()) {
+					newMesh->weights.resize(newPrimitive->morphTargets.size(), 0.0f);
+				}
+			}
 			newMesh->primitives.push_back(newPrimitive);
 		}
+		// Default weights, instances of the mesh may override them
+		if (!newMesh->weights.empty()) {
+			const std::vector<double>& weights = node.weights.empty() ? mesh.weights : node.weights;
+			for (size_t i = 0; i < std::min(weights.size(), newMesh->weights.size()); i++) {
+				newMesh->weights[i] = static_cast<float>(weights[i]);
+			}
+		}
 		newNode->mesh = newMesh;
 	}
 	if (parent) {
@@ -957,6 +1795,105 @@ void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, u
 	linearNodes.push_back(newNode);
 }
 
+/*
+	Merges duplicate vertices of each primitive and compacts the vertex buffer
+	Vertices are not shared across primitives, as pre-transformation and color pre-multiplication are applied per primitive
+	Primitives with morph targets are only moved, as their deltas reference the original vertices
+*/
+void vkglTF::Model::weldVertices(std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer)
+{
+	std::vector<Primitive*> primitives;
+	for (Node* node : linearNodes) {
+		if (node->mesh) {
+			primitives.insert(primitives.end(), node->mesh->primitives.begin(), node->mesh->primitives.end());
+		}
+	}
+	// Primitives are compacted front to back, so process them in vertex buffer order
+	std::sort(primitives.begin(), primitives.end(), [](const Primitive* a, const Primitive* b) { return a->firstVertex < b->firstVertex; });
+
+	const size_t vertexCountBefore = vertexBuffer.size();
+	std::vector<uint32_t> remap;
+	uint32_t vertexEnd = 0;
+	for (Primitive* primitive : primitives) {
+		if (primitive->vertexCount == 0) {
+			primitive->firstVertex = vertexEnd;
+			continue;
+		}
+		uint8_t* vertexData = reinterpret_cast<uint8_t*>(&vertexBuffer[primitive->firstVertex]);
+		remap.resize(primitive->vertexCount);
+		uint32_t uniqueCount = primitive->vertexCount;
+		if (primitive->morphTargets.empty()) {
+			uniqueCount = static_cast<uint32_t>(vks::meshoptimizer::generateVertexRemap(remap.data(), vertexData, primitive->vertexCount, sizeof(Vertex), vertexWeldEpsilon));
+			vks::meshoptimizer::remapVertexBuffer(vertexData, primitive->vertexCount, sizeof(Vertex), remap.data());
+		} else {
+			std::iota(remap.begin(), remap.end(), 0);
+		}
+		// Move the unique vertices down to the end of the previous primitive
+		if (vertexEnd != primitive->firstVertex) {
+			std::copy(vertexBuffer.begin() + primitive->firstVertex, vertexBuffer.begin() + primitive->firstVertex + uniqueCount, vertexBuffer.begin() + vertexEnd);
+		}
+		for (uint32_t i = primitive->firstIndex; i < primitive->firstIndex + primitive->indexCount; i++) {
+			indexBuffer[i] = remap[indexBuffer[i] - primitive->firstVertex] + vertexEnd;
+		}
+		primitive->firstVertex = vertexEnd;
+		primitive->vertexCount = uniqueCount;
+		vertexEnd += uniqueCount;
+	}
+	vertexBuffer.resize(vertexEnd);
+	std::cout << "Vertex welding: " << vertexCountBefore << " -> " << vertexBuffer.size() << " vertices";
+	if (vertexCountBefore > 0) {
+		std::cout << " (" << 100.0f * (float)(vertexCountBefore - vertexBuffer.size()) / (float)vertexCountBefore << "% removed)";
+	}
+	std::cout << std::endl;
+}
+
+/*
+	Runs vertex cache, overdraw and vertex fetch optimization on all primitives and stores the vertex cache statistics before and after in optimizationStatistics
+*/
+void vkglTF::Model::optimizeMeshes(std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer)
+{
+	namespace meshopt = vks::meshoptimizer;
+	meshopt::VertexCacheStatistics before, after;
+	std::vector<uint32_t> localIndices;
+	std::vector<uint32_t> optimizedIndices;
+	std::vector<uint32_t> clusters;
+	for (Node* node : linearNodes) {
+		if (!node->mesh) {
+			continue;
+		}
+		for (Primitive* primitive : node->mesh->primitives) {
+			if (primitive->indexCount < 3 || primitive->vertexCount == 0) {
+				continue;
+			}
+			// The optimizer works on primitive relative indices
+			localIndices.resize(primitive->indexCount);
+			for (uint32_t i = 0; i < primitive->indexCount; i++) {
+				localIndices[i] = indexBuffer[primitive->firstIndex + i] - primitive->firstVertex;
+			}
+			before += meshopt::analyzeVertexCache(localIndices.data(), localIndices.size(), primitive->vertexCount);
+
+			uint8_t* vertexData = reinterpret_cast<uint8_t*>(&vertexBuffer[primitive->firstVertex]);
+			optimizedIndices.resize(localIndices.size());
+			meshopt::optimizeVertexCache(optimizedIndices.data(), localIndices.data(), localIndices.size(), primitive->vertexCount, &clusters);
+			meshopt::optimizeOverdraw(optimizedIndices.data(), optimizedIndices.size(), clusters, vertexData + offsetof(Vertex, pos), sizeof(Vertex), primitive->dimensions.center);
+			// Morph target deltas reference the original vertex order
+			if (primitive->morphTargets.empty()) {
+				meshopt::optimizeVertexFetch(vertexData, sizeof(Vertex), optimizedIndices.data(), optimizedIndices.size(), primitive->vertexCount);
+			}
+
+			after += meshopt::analyzeVertexCache(optimizedIndices.data(), optimizedIndices.size(), primitive->vertexCount);
+			for (uint32_t i = 0; i < primitive->indexCount; i++) {
+				indexBuffer[primitive->firstIndex + i] = optimizedIndices[i] + primitive->firstVertex;
+			}
+		}
+	}
+	optimizationStatistics.acmrBefore = before.acmr();
+	optimizationStatistics.acmrAfter = after.acmr();
+	optimizationStatistics.atvrBefore = before.atvr();
+	optimizationStatistics.atvrAfter = after.atvr();
+	optimizationStatistics.triangles = static_cast<uint32_t>(after.triangles);
+}
+
 void vkglTF::Model::loadSkins(tinygltf::Model &gltfModel)
 {
 	for (tinygltf::Skin &source : gltfModel.skins) {
@@ -972,29 +1909,98 @@ void vkglTF::Model::loadSkins(tinygltf::Model &gltfModel)
 		for (int jointIndex : source.joints) {
 			Node* node = nodeFromIndex(jointIndex);
 			if (node) {
-				newSkin->joints.push_back(nodeFromIndex(jointIndex));
+				newSkin->joints.push_back(node);
 			}
 		}
 
 		// Get inverse bind matrices from buffer
 		if (source.inverseBindMatrices > -1) {
 			const tinygltf::Accessor &accessor = gltfModel.accessors[source.inverseBindMatrices];
-			const tinygltf::BufferView &bufferView = gltfModel.bufferViews[accessor.bufferView];
-			const tinygltf::Buffer &buffer = gltfModel.buffers[bufferView.buffer];
 			newSkin->inverseBindMatrices.resize(accessor.count);
-			memcpy(newSkin->inverseBindMatrices.data(), &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::mat4));
+			memcpy(newSkin->inverseBindMatrices.data(), getAccessorData(gltfModel, accessor), accessor.count * sizeof(glm::mat4));
 		}
 
 		skins.push_back(newSkin);
 	}
 }
 
-void vkglTF::Model::loadImages(tinygltf::Model &gltfModel, vks::VulkanDevice *device, VkQueue transferQueue)
+void vkglTF::Model::loadImages(tinygltf::Model &gltfModel, vks::VulkanDevice *device, VkQueue transferQueue, bool parallelDecoding)
 {
-	for (tinygltf::Image &image : gltfModel.images) {
-		vkglTF::Texture texture;
-		texture.fromglTfImage(image, path, device, transferQueue);
-		textures.push_back(texture);
+	if (!parallelDecoding) {
+		for (tinygltf::Image &image : gltfModel.images) {
+			vkglTF::Texture texture;
+			texture.fromglTfImage(image, path, device, transferQueue);
+			textures.push_back(texture);
+		}
+	} else {
+		// Images still hold their encoded files (see loadImageDataFuncDeferred)
+		// Worker threads decode them straight to RGBA, while this thread uploads every image as soon as it has been decoded
+		const size_t imageCount = gltfModel.images.size();
+		const size_t firstTexture = textures.size();
+		textures.resize(firstTexture + imageCount);
+
+		std::atomic<size_t> nextImage(0);
+		std::mutex readyMutex;
+		std::condition_variable readyCondition;
+		std::queue<size_t> readyImages;
+		std::string decodeErrors;
+
+		auto decodeImages = [&]() {
+			size_t index;
+			while ((index = nextImage++) < imageCount) {
+				tinygltf::Image& image = gltfModel.images[index];
+				std::string error;
+				if ((image.component == 0) && !image.image.empty()) {
+					int width, height, components;
+					unsigned char* pixels = stbi_load_from_memory(image.image.data(), static_cast<int>(image.image.size()), &width, &height, &components, 4);
+					if (pixels) {
+						image.width = width;
+						image.height = height;
+						image.component = 4;
+						image.bits = 8;
+						image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+						image.image.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+						stbi_image_free(pixels);
+					} else {
+						error = "Could not decode image " + std::to_string(index) + " \"" + image.uri + "\": " + stbi_failure_reason() + "\n";
+					}
+				}
+				std::lock_guard<std::mutex> lock(readyMutex);
+				decodeErrors += error;
+				readyImages.push(index);
+				readyCondition.notify_one();
+			}
+		};
+
+		const size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), imageCount);
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < threadCount; i++) {
+			workers.push_back(std::thread(decodeImages));
+		}
+
+		for (size_t uploaded = 0; uploaded < imageCount; uploaded++) {
+			size_t index;
+			{
+				std::unique_lock<std::mutex> lock(readyMutex);
+				readyCondition.wait(lock, [&readyImages] { return !readyImages.empty(); });
+				index = readyImages.front();
+				readyImages.pop();
+				if (!decodeErrors.empty()) {
+					break;
+				}
+			}
+			tinygltf::Image& image = gltfModel.images[index];
+			textures[firstTexture + index].fromglTfImage(image, path, device, transferQueue);
+			// Pixel data is no longer required once it has been uploaded
+			std::vector<unsigned char>().swap(image.image);
+		}
+
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		if (!decodeErrors.empty()) {
+			vks::tools::exitFatal(decodeErrors, -1);
+		}
 	}
 	// Create an empty texture to be used for empty material images
 	createEmptyTexture(transferQueue);
@@ -1076,17 +2082,11 @@ void vkglTF::Model::loadAnimations(tinygltf::Model &gltfModel)
 			// Read sampler input time values
 			{
 				const tinygltf::Accessor &accessor = gltfModel.accessors[samp.input];
-				const tinygltf::BufferView &bufferView = gltfModel.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer &buffer = gltfModel.buffers[bufferView.buffer];
 
 				assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
 
-				float *buf = new float[accessor.count];
-				memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(float));
-				for (size_t index = 0; index < accessor.count; index++) {
-					sampler.inputs.push_back(buf[index]);
-				}
-                delete[] buf;
+				const float *buf = reinterpret_cast<const float *>(getAccessorData(gltfModel, accessor));
+				sampler.inputs.assign(buf, buf + accessor.count);
 				for (auto input : sampler.inputs) {
 					if (input < animation.start) {
 						animation.start = input;
@@ -1097,32 +2097,29 @@ void vkglTF::Model::loadAnimations(tinygltf::Model &gltfModel)
 				}
 			}
 
-			// Read sampler output T/R/S values 
+			// Read sampler output T/R/S/W values 
 			{
 				const tinygltf::Accessor &accessor = gltfModel.accessors[samp.output];
-				const tinygltf::BufferView &bufferView = gltfModel.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer &buffer = gltfModel.buffers[bufferView.buffer];
+				const float *data = reinterpret_cast<const float *>(getAccessorData(gltfModel, accessor));
 
 				assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
 
 				switch (accessor.type) {
+				case TINYGLTF_TYPE_SCALAR: {
+					sampler.outputs.assign(data, data + accessor.count);
+					break;
+				}
 				case TINYGLTF_TYPE_VEC3: {
-					glm::vec3 *buf = new glm::vec3[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::vec3));
 					for (size_t index = 0; index < accessor.count; index++) {
-						sampler.outputsVec4.push_back(glm::vec4(buf[index], 0.0f));
+						sampler.outputsVec4.push_back(glm::vec4(glm::make_vec3(&data[index * 3]), 0.0f));
 					}
-                    delete[] buf;
-                    break;
+					break;
 				}
 				case TINYGLTF_TYPE_VEC4: {
-					glm::vec4 *buf = new glm::vec4[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::vec4));
 					for (size_t index = 0; index < accessor.count; index++) {
-						sampler.outputsVec4.push_back(buf[index]);
+						sampler.outputsVec4.push_back(glm::make_vec4(&data[index * 4]));
 					}
-                    delete[] buf;
-                    break;
+					break;
 				}
 				default: {
 					std::cout << "unknown type" << std::endl;
@@ -1148,14 +2145,17 @@ void vkglTF::Model::loadAnimations(tinygltf::Model &gltfModel)
 				channel.path = AnimationChannel::PathType::SCALE;
 			}
 			if (source.target_path == "weights") {
-				std::cout << "weights not yet supported, skipping channel" << std::endl;
-				continue;
+				channel.path = AnimationChannel::PathType::WEIGHTS;
 			}
 			channel.samplerIndex = source.sampler;
 			channel.node = nodeFromIndex(source.target_node);
 			if (!channel.node) {
 				continue;
 			}
+			if ((channel.path == AnimationChannel::PathType::WEIGHTS) && (!channel.node->mesh || channel.node->mesh->weights.empty())) {
+				std::cout << "weights channel without morph targets (see FileLoadingFlags::MorphTargets), skipping channel" << std::endl;
+				continue;
+			}
 
 			animation.channels.push_back(channel);
 		}
@@ -1168,10 +2168,13 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 {
 	tinygltf::Model gltfModel;
 	tinygltf::TinyGLTF gltfContext;
+	const bool parallelImageDecoding = fileLoadingFlags & FileLoadingFlags::ParallelImageDecoding;
+	tinygltf::LoadImageDataFunction imageLoader = parallelImageDecoding ? loadImageDataFuncDeferred : loadImageDataFunc;
 	if (fileLoadingFlags & FileLoadingFlags::DontLoadImages) {
 		gltfContext.SetImageLoader(loadImageDataFuncEmpty, nullptr);
+		imageLoader = nullptr;
 	} else {
-		gltfContext.SetImageLoader(loadImageDataFunc, nullptr);
+		gltfContext.SetImageLoader(imageLoader, nullptr);
 	}
 #if defined(__ANDROID__)
 	// On Android all assets are packed with the apk in a compressed form, so we need to open them using the asset manager
@@ -1184,23 +2187,50 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 	std::string error, warning;
 
 	this->device = device;
+	morphTargetsEnabled = fileLoadingFlags & FileLoadingFlags::MorphTargets;
 
 #if defined(__ANDROID__)
 	// On Android all assets are packed with the apk in a compressed form, so we need to open them using the asset manager
 	// We let tinygltf handle this, by passing the asset manager of our app
 	tinygltf::asset_manager = androidApp->activity->assetManager;
 #endif
-	bool fileLoaded = gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, filename);
+	const bool binary = (filename.find_last_of('.') != std::string::npos) && (filename.substr(filename.find_last_of('.') + 1) == "glb");
+#if defined(__ANDROID__)
+	// Assets are stored compressed inside the apk on Android, so they can't be mapped
+	const bool memoryMapped = false;
+#else
+	const bool memoryMapped = fileLoadingFlags & FileLoadingFlags::MemoryMappedBuffers;
+#endif
+	// Mappings need to stay alive until all accessors have been read and uploaded
+	std::vector<std::unique_ptr<MappedFile>> mappedFiles;
+	bufferData.clear();
+
+	bool fileLoaded = false;
+	if (memoryMapped) {
+		fileLoaded = loadMemoryMapped(gltfContext, gltfModel, filename, path, binary, imageLoader, mappedFiles, bufferData, error, warning);
+	} else if (binary) {
+		fileLoaded = gltfContext.LoadBinaryFromFile(&gltfModel, &error, &warning, filename);
+	} else {
+		fileLoaded = gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, filename);
+	}
+	if (fileLoaded && bufferData.empty()) {
+		for (auto& buffer : gltfModel.buffers) {
+			bufferData.push_back(buffer.data.data());
+		}
+	}
 
 	std::vector<uint32_t> indexBuffer;
 	std::vector<Vertex> vertexBuffer;
 
 	if (fileLoaded) {
+		// All image and buffer uploads of the model are collected into a single upload batch
+		device->beginUploadBatch(transferQueue);
 		if (!(fileLoadingFlags & FileLoadingFlags::DontLoadImages)) {
-			loadImages(gltfModel, device, transferQueue);
+			loadImages(gltfModel, device, transferQueue, parallelImageDecoding);
 		}
 		loadMaterials(gltfModel);
 		const tinygltf::Scene &scene = gltfModel.scenes[gltfModel.defaultScene > -1 ? gltfModel.defaultScene : 0];
+		nodeTable.assign(gltfModel.nodes.size(), nullptr);
 		for (size_t i = 0; i < scene.nodes.size(); i++) {
 			const tinygltf::Node node = gltfModel.nodes[scene.nodes[i]];
 			loadNode(nullptr, node, scene.nodes[i], gltfModel, indexBuffer, vertexBuffer, scale);
@@ -1210,16 +2240,30 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		}
 		loadSkins(gltfModel);
 
+		transforms.build(nodes);
+		transforms.update();
+		// Assign skins and reserve the joint palette range of each skinned mesh
+		uint32_t jointCount = 0;
 		for (auto node : linearNodes) {
-			// Assign skins
 			if (node->skinIndex > -1) {
 				node->skin = skins[node->skinIndex];
 			}
-			// Initial pose
+			if (node->mesh && node->skin) {
+				node->mesh->uniformBlock.jointOffset = jointCount;
+				node->mesh->uniformBlock.jointCount = static_cast<uint32_t>(node->skin->joints.size());
+				jointCount += node->mesh->uniformBlock.jointCount;
+			}
+		}
+		jointPalette.create(device, jointCount);
+		for (auto node : linearNodes) {
 			if (node->mesh) {
-				node->update();
+				node->mesh->jointPalette = &jointPalette;
+				memcpy(node->mesh->uniformBuffer.mapped, &node->mesh->uniformBlock, sizeof(node->mesh->uniformBlock));
+				// Initial pose
+				node->updateMesh();
 			}
 		}
+		jointPalette.upload();
 	}
 	else {
 		// TODO: throw
@@ -1227,15 +2271,28 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		return;
 	}
 
+	// Remove duplicate vertices first, so the mesh optimization works on the final topology
+	if (fileLoadingFlags & FileLoadingFlags::WeldVertices) {
+		weldVertices(indexBuffer, vertexBuffer);
+	}
+
+	// Optimize the index and vertex order of each primitive before any other vertex processing
+	if (fileLoadingFlags & FileLoadingFlags::OptimizeMeshes) {
+		optimizeMeshes(indexBuffer, vertexBuffer);
+	}
+
 	// Pre-Calculations for requested features
 	if ((fileLoadingFlags & FileLoadingFlags::PreTransformVertices) || (fileLoadingFlags & FileLoadingFlags::PreMultiplyVertexColors) || (fileLoadingFlags & FileLoadingFlags::FlipY)) {
 		const bool preTransform = fileLoadingFlags & FileLoadingFlags::PreTransformVertices;
 		const bool preMultiplyColor = fileLoadingFlags & FileLoadingFlags::PreMultiplyVertexColors;
 		const bool flipY = fileLoadingFlags & FileLoadingFlags::FlipY;
+		preTransformed = preTransform;
 		for (Node* node : linearNodes) {
 			if (node->mesh) {
 				const glm::mat4 localMatrix = node->getMatrix();
 				for (Primitive* primitive : node->mesh->primitives) {
+					glm::vec3 posMin(FLT_MAX);
+					glm::vec3 posMax(-FLT_MAX);
 					for (uint32_t i = 0; i < primitive->vertexCount; i++) {
 						Vertex& vertex = vertexBuffer[primitive->firstVertex + i];
 						// Pre-transform vertex positions by node-hierarchy
@@ -1252,6 +2309,26 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 						if (preMultiplyColor) {
 							vertex.color = primitive->material.baseColorFactor * vertex.color;
 						}
+						posMin = glm::min(posMin, vertex.pos);
+						posMax = glm::max(posMax, vertex.pos);
+					}
+					// Keep the bounds in the same space as the vertices, as they are used for culling
+					if ((preTransform || flipY) && (primitive->vertexCount > 0)) {
+						primitive->setDimensions(posMin, posMax);
+					}
+					// Morph target deltas are directions, so they are only rotated and scaled
+					for (const MorphTarget& target : primitive->morphTargets) {
+						for (uint32_t i = target.firstDelta; i < target.firstDelta + target.deltaCount; i++) {
+							MorphTargets::Delta& delta = morphTargets.deltas[i];
+							if (preTransform) {
+								delta.position = glm::mat3(localMatrix) * delta.position;
+								delta.normal = glm::mat3(localMatrix) * delta.normal;
+							}
+							if (flipY) {
+								delta.position.y *= -1.0f;
+								delta.normal.y *= -1.0f;
+							}
+						}
 					}
 				}
 			}
@@ -1265,36 +2342,76 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		}
 	}
 
-	size_t vertexBufferSize = vertexBuffer.size() * sizeof(Vertex);
-	size_t indexBufferSize = indexBuffer.size() * sizeof(uint32_t);
+	// Convert to the packed layout after all pre-calculations have been applied to the full vertices
+	std::vector<uint8_t> packedVertexBuffer;
+	const bool morphTargetsPresent = !morphTargets.deltas.empty();
+	bool packVertices = (fileLoadingFlags & FileLoadingFlags::PackedVertices) != 0;
+	if (packVertices && morphTargetsPresent) {
+		std::cerr << "Morph targets require the default vertex layout, ignoring FileLoadingFlags::PackedVertices" << std::endl;
+		packVertices = false;
+	}
+	// Packed joint indices are 8 bits wide
+	if (packVertices && (std::find(packedVertexComponents.begin(), packedVertexComponents.end(), VertexComponent::Joint0) != packedVertexComponents.end())) {
+		for (const Vertex& vertex : vertexBuffer) {
+			if (glm::max(glm::max(vertex.joint0.x, vertex.joint0.y), glm::max(vertex.joint0.z, vertex.joint0.w)) >= 256.0f) {
+				std::cerr << "Joint indices above 255 don't fit the packed vertex layout, ignoring FileLoadingFlags::PackedVertices" << std::endl;
+				packVertices = false;
+				break;
+			}
+		}
+	}
+	if (packVertices) {
+		vertices.stride = PackedVertex::stride(packedVertexComponents);
+		packedVertexBuffer.resize(vertexBuffer.size() * vertices.stride);
+		for (size_t i = 0; i < vertexBuffer.size(); i++) {
+			PackedVertex::pack(vertexBuffer[i], packedVertexComponents, &packedVertexBuffer[i * vertices.stride]);
+		}
+	} else {
+		vertices.stride = sizeof(Vertex);
+	}
+
+	size_t vertexBufferSize = vertexBuffer.size() * vertices.stride;
+	// Select the smallest index type that can address all vertices
+	// Shaders reading the index buffer directly (e.g. for ray tracing) expect 32-bit indices
+	std::vector<uint16_t> indexBuffer16;
+	indices.type = VK_INDEX_TYPE_UINT32;
+	if (!(memoryPropertyFlags & (VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT))) {
+		if (vertexBuffer.size() <= std::numeric_limits<uint16_t>::max()) {
+			indices.type = VK_INDEX_TYPE_UINT16;
+			indexBuffer16.assign(indexBuffer.begin(), indexBuffer.end());
+		} else if (fileLoadingFlags & FileLoadingFlags::RelativeIndices16) {
+			// Indices may still fit if made relative to the first vertex of each primitive
+			bool primitivesFit = true;
+			for (auto node : linearNodes) {
+				if (node->mesh) {
+					for (Primitive* primitive : node->mesh->primitives) {
+						primitivesFit &= (primitive->vertexCount <= std::numeric_limits<uint16_t>::max());
+					}
+				}
+			}
+			if (primitivesFit) {
+				indices.type = VK_INDEX_TYPE_UINT16;
+				indexBuffer16.resize(indexBuffer.size());
+				for (auto node : linearNodes) {
+					if (node->mesh) {
+						for (Primitive* primitive : node->mesh->primitives) {
+							primitive->vertexOffset = static_cast<int32_t>(primitive->firstVertex);
+							for (uint32_t i = primitive->firstIndex; i < primitive->firstIndex + primitive->indexCount; i++) {
+								indexBuffer16[i] = static_cast<uint16_t>(indexBuffer[i] - primitive->firstVertex);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	size_t indexBufferSize = indexBuffer.size() * (indices.type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
 	indices.count = static_cast<uint32_t>(indexBuffer.size());
 	vertices.count = static_cast<uint32_t>(vertexBuffer.size());
 
 	assert((vertexBufferSize > 0) && (indexBufferSize > 0));
 
-	struct StagingBuffer {
-		VkBuffer buffer;
-		VkDeviceMemory memory;
-	} vertexStaging, indexStaging;
-
-	// Create staging buffers
-	// Vertex data
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		vertexBufferSize,
-		&vertexStaging.buffer,
-		&vertexStaging.memory,
-		vertexBuffer.data()));
-	// Index data
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		indexBufferSize,
-		&indexStaging.buffer,
-		&indexStaging.memory,
-		indexBuffer.data()));
-
 	// Create device local buffers
 	// Vertex buffer
 	VK_CHECK_RESULT(device->createBuffer(
@@ -1311,25 +2428,64 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		&indices.buffer,
 		&indices.memory));
 
-	// Copy from staging buffers
-	VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	// Copy through the upload batch's staging ring, this also submits all image uploads of the model
+	device->uploadBuffer(vertices.buffer, packedVertexBuffer.empty() ? static_cast<const void*>(vertexBuffer.data()) : packedVertexBuffer.data(), vertexBufferSize);
+	device->uploadBuffer(indices.buffer, indexBuffer16.empty() ? static_cast<const void*>(indexBuffer.data()) : indexBuffer16.data(), indexBufferSize);
 
-	VkBufferCopy copyRegion = {};
-
-	copyRegion.size = vertexBufferSize;
-	vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, vertices.buffer, 1, &copyRegion);
+	if (fileLoadingFlags & FileLoadingFlags::PositionOnlyStream) {
+		std::vector<glm::vec3> positionBuffer(vertexBuffer.size());
+		for (size_t i = 0; i < vertexBuffer.size(); i++) {
+			positionBuffer[i] = vertexBuffer[i].pos;
+		}
+		const VkDeviceSize positionBufferSize = positionBuffer.size() * sizeof(glm::vec3);
+		VK_CHECK_RESULT(device->createBuffer(
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			positionBufferSize,
+			&positions.buffer,
+			&positions.memory));
+		device->uploadBuffer(positions.buffer, positionBuffer.data(), positionBufferSize);
+	}
 
-	copyRegion.size = indexBufferSize;
-	vkCmdCopyBuffer(copyCmd, indexStaging.buffer, indices.buffer, 1, &copyRegion);
+	if (morphTargetsPresent) {
+		// Morphed primitives are blended from a copy of their base vertices, the staging buffers are created per frame in flight by prepareMorphTargets
+		for (auto node : linearNodes) {
+			if (!node->mesh || node->mesh->weights.empty()) {
+				continue;
+			}
+			for (Primitive* primitive : node->mesh->primitives) {
+				if (primitive->morphTargets.empty() || (primitive->vertexCount == 0)) {
+					continue;
+				}
+				const uint32_t firstBase = static_cast<uint32_t>(morphTargets.baseVertices.size());
+				morphTargets.baseVertices.insert(morphTargets.baseVertices.end(), vertexBuffer.begin() + primitive->firstVertex, vertexBuffer.begin() + primitive->firstVertex + primitive->vertexCount);
+				VkBufferCopy copyRegion{ firstBase * sizeof(Vertex), primitive->firstVertex * sizeof(Vertex), primitive->vertexCount * sizeof(Vertex) };
+				if (!morphTargets.vertexCopies.empty() && (morphTargets.vertexCopies.back().srcOffset + morphTargets.vertexCopies.back().size == copyRegion.srcOffset) &&
+					(morphTargets.vertexCopies.back().dstOffset + morphTargets.vertexCopies.back().size == copyRegion.dstOffset)) {
+					morphTargets.vertexCopies.back().size += copyRegion.size;
+				} else {
+					morphTargets.vertexCopies.push_back(copyRegion);
+				}
+			}
+		}
+		// Positions are stored after the vertices in the staging buffers
+		if (positions.buffer != VK_NULL_HANDLE) {
+			const VkDeviceSize positionsOffset = morphTargets.baseVertices.size() * sizeof(Vertex);
+			for (const VkBufferCopy& vertexCopy : morphTargets.vertexCopies) {
+				morphTargets.positionCopies.push_back({ positionsOffset + vertexCopy.srcOffset / sizeof(Vertex) * sizeof(glm::vec3), vertexCopy.dstOffset / sizeof(Vertex) * sizeof(glm::vec3), vertexCopy.size / sizeof(Vertex) * sizeof(glm::vec3) });
+			}
+		}
+		updateMorphTargets();
+	}
 
-	device->flushCommandBuffer(copyCmd, transferQueue, true);
+	device->endUploadBatch();
 
-	vkDestroyBuffer(device->logicalDevice, vertexStaging.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, vertexStaging.memory, nullptr);
-	vkDestroyBuffer(device->logicalDevice, indexStaging.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, indexStaging.memory, nullptr);
+	// Buffer data is no longer required, mapped files are released when going out of scope
+	bufferData.clear();
 
 	getSceneDimensions();
+	bvh.build(linearNodes, preTransformed);
+	invalidateDrawLists();
 
 	// Setup descriptors
 	uint32_t uboCount{ 0 };
@@ -1346,6 +2502,7 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 	}
 	std::vector<VkDescriptorPoolSize> poolSizes = {
 		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uboCount },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, uboCount },
 	};
 	if (imageCount > 0) {
 		if (descriptorBindingFlags & DescriptorBindingFlags::ImageBaseColor) {
@@ -1368,6 +2525,7 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		if (descriptorSetLayoutUbo == VK_NULL_HANDLE) {
 			std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
 				vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
+				vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1),
 			};
 			VkDescriptorSetLayoutCreateInfo descriptorLayoutCI{};
 			descriptorLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -1405,39 +2563,149 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 	}
 }
 
-void vkglTF::Model::bindBuffers(VkCommandBuffer commandBuffer)
+// Selects the position only stream for depth only passes
+const VkBuffer* vkglTF::Model::getVertexBuffer(uint32_t renderFlags) const
+{
+	return ((renderFlags & RenderFlags::DepthOnly) && (positions.buffer != VK_NULL_HANDLE)) ? &positions.buffer : &vertices.buffer;
+}
+
+void vkglTF::Model::bindBuffers(VkCommandBuffer commandBuffer, uint32_t renderFlags)
 {
 	const VkDeviceSize offsets[1] = {0};
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
-	vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, getVertexBuffer(renderFlags), offsets);
+	vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, indices.type);
 	buffersBound = true;
 }
 
-void vkglTF::Model::drawNode(Node *node, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet, uint32_t instanceCount)
+/*
+	Tests the bounds of a primitive, transformed by the world matrix of its node, against a world space frustum
+	Skinned and morphed primitives are always visible, as their vertices may move outside of their rest pose bounds
+*/
+bool vkglTF::Model::isPrimitiveVisible(Node* node, Primitive* primitive, const vks::Frustum& frustum)
 {
-	if (node->mesh) {
+	if (node->skin || !primitive->morphTargets.empty()) {
+		return true;
+	}
+	glm::vec3 min, max;
+	primitive->getBounds(preTransformed ? glm::mat4(1.0f) : node->getMatrix(), min, max);
+	return frustum.checkBox(min, max);
+}
+
+// Returns true if primitives with the given alpha mode are filtered out by the render flags
+static bool skipAlphaMode(vkglTF::Material::AlphaMode alphaMode, uint32_t renderFlags)
+{
+	bool skip = false;
+	if (renderFlags & vkglTF::RenderFlags::RenderOpaqueNodes) {
+		skip = (alphaMode != vkglTF::Material::ALPHAMODE_OPAQUE);
+	}
+	if (renderFlags & vkglTF::RenderFlags::RenderAlphaMaskedNodes) {
+		skip = (alphaMode != vkglTF::Material::ALPHAMODE_MASK);
+	}
+	if (renderFlags & vkglTF::RenderFlags::RenderAlphaBlendedNodes) {
+		skip = (alphaMode != vkglTF::Material::ALPHAMODE_BLEND);
+	}
+	return skip;
+}
+
+// Binds the material descriptor set only if it differs from the one bound by the previous primitive of the current draw call
+void vkglTF::Model::drawPrimitive(Primitive* primitive, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet, uint32_t instanceCount)
+{
+	if ((renderFlags & RenderFlags::BindImages) && (primitive->material.descriptorSet != boundMaterialSet)) {
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet, 1, &primitive->material.descriptorSet, 0, nullptr);
+		boundMaterialSet = primitive->material.descriptorSet;
+		drawStatistics.descriptorSetBinds++;
+	}
+	vkCmdDrawIndexed(commandBuffer, primitive->indexCount, instanceCount, primitive->firstIndex, primitive->vertexOffset, 0);
+	drawStatistics.drawCalls++;
+}
+
+/*
+	Collects the primitives of all nodes into one list per alpha mode, sorted by material and then by index buffer offset
+	Each item references its bvh item, so the frustum culled draw can filter the lists without changing their order
+*/
+void vkglTF::Model::buildDrawLists()
+{
+	for (auto& list : drawLists.items) {
+		list.clear();
+	}
+	std::unordered_map<const Primitive*, uint32_t> bvhItems;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(bvh.items.size()); i++) {
+		bvhItems[bvh.items[i].primitive] = i;
+	}
+	for (auto node : linearNodes) {
+		if (!node->mesh) {
+			continue;
+		}
 		for (Primitive* primitive : node->mesh->primitives) {
-			bool skip = false;
-			const vkglTF::Material& material = primitive->material;
-			if (renderFlags & RenderFlags::RenderOpaqueNodes) {
-				skip = (material.alphaMode != Material::ALPHAMODE_OPAQUE);
+			uint32_t bvhItem = unboundedItem;
+			auto it = bvhItems.find(primitive);
+			if (it != bvhItems.end()) {
+				bvhItem = it->second;
 			}
-			if (renderFlags & RenderFlags::RenderAlphaMaskedNodes) {
-				skip = (material.alphaMode != Material::ALPHAMODE_MASK);
-			}
-			if (renderFlags & RenderFlags::RenderAlphaBlendedNodes) {
-				skip = (material.alphaMode != Material::ALPHAMODE_BLEND);
+			drawLists.items[primitive->material.alphaMode].push_back(DrawItem{ node, primitive, 0.0f, bvhItem });
+		}
+	}
+	// Primitives reference materials stored in one vector, so their addresses order them by material index
+	auto byMaterial = [](const DrawItem& a, const DrawItem& b) {
+		if (&a.primitive->material != &b.primitive->material) {
+			return &a.primitive->material < &b.primitive->material;
+		}
+		return a.primitive->firstIndex < b.primitive->firstIndex;
+	};
+	std::sort(drawLists.items[Material::ALPHAMODE_OPAQUE].begin(), drawLists.items[Material::ALPHAMODE_OPAQUE].end(), byMaterial);
+	std::sort(drawLists.items[Material::ALPHAMODE_MASK].begin(), drawLists.items[Material::ALPHAMODE_MASK].end(), byMaterial);
+	drawLists.dirty = false;
+}
+
+void vkglTF::Model::invalidateDrawLists()
+{
+	drawLists.dirty = true;
+}
+
+/*
+	Sorts the blended primitives back to front by the distance of their world space bounds center to the given position
+	Blending depends on draw order, so call this whenever the camera or blended nodes move and re-record the command buffers
+*/
+void vkglTF::Model::sortBlendedPrimitives(const glm::vec3& viewPosition)
+{
+	if (drawLists.dirty) {
+		buildDrawLists();
+	}
+	std::vector<DrawItem>& blended = drawLists.items[Material::ALPHAMODE_BLEND];
+	for (DrawItem& item : blended) {
+		glm::vec3 min, max;
+		item.primitive->getBounds(preTransformed ? glm::mat4(1.0f) : item.node->getMatrix(), min, max);
+		item.viewDistance = glm::distance((min + max) * 0.5f, viewPosition);
+	}
+	std::stable_sort(blended.begin(), blended.end(), [](const DrawItem& a, const DrawItem& b) { return a.viewDistance > b.viewDistance; });
+}
+
+void vkglTF::Model::resetDrawStatistics()
+{
+	drawStatistics = {};
+}
+
+void vkglTF::Model::drawNode(Node *node, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet, uint32_t instanceCount, const vks::Frustum* frustum)
+{
+	// Callers may bind other sets between nodes, so only consecutive primitives of a mesh share binds
+	boundMaterialSet = VK_NULL_HANDLE;
+	if (node->mesh) {
+		for (Primitive* primitive : node->mesh->primitives) {
+			const bool skip = skipAlphaMode(primitive->material.alphaMode, renderFlags);
+			if (!skip && frustum) {
+				if (!isPrimitiveVisible(node, primitive, *frustum)) {
+					drawStatistics.culledPrimitives++;
+					continue;
+				}
+				drawStatistics.drawnPrimitives++;
 			}
 			if (!skip) {
-				if (renderFlags & RenderFlags::BindImages) {
-					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet, 1, &material.descriptorSet, 0, nullptr);
-				}
-				vkCmdDrawIndexed(commandBuffer, primitive->indexCount, instanceCount, primitive->firstIndex, 0, 0);
+				drawPrimitive(primitive, commandBuffer, renderFlags, pipelineLayout, bindImageSet, instanceCount);
 			}
 		}
 	}
 	for (auto& child : node->children) {
-		drawNode(child, commandBuffer, renderFlags, pipelineLayout, bindImageSet, instanceCount);
+		drawNode(child, commandBuffer, renderFlags, pipelineLayout, bindImageSet, instanceCount, frustum);
 	}
 }
 
@@ -1445,11 +2713,52 @@ void vkglTF::Model::draw(VkCommandBuffer commandBuffer, uint32_t renderFlags, Vk
 {
 	if (!buffersBound) {
 		const VkDeviceSize offsets[1] = {0};
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, getVertexBuffer(renderFlags), offsets);
+		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, indices.type);
 	}
-	for (auto& node : nodes) {
-		drawNode(node, commandBuffer, renderFlags, pipelineLayout, bindImageSet, instanceCount);
+	if (drawLists.dirty) {
+		buildDrawLists();
+	}
+	boundMaterialSet = VK_NULL_HANDLE;
+	// Without alpha mode flags all lists are drawn, opaque first and blended last
+	for (uint32_t alphaMode = 0; alphaMode < 3; alphaMode++) {
+		if (skipAlphaMode(static_cast<Material::AlphaMode>(alphaMode), renderFlags)) {
+			continue;
+		}
+		for (const DrawItem& item : drawLists.items[alphaMode]) {
+			drawPrimitive(item.primitive, commandBuffer, renderFlags, pipelineLayout, bindImageSet, instanceCount);
+		}
+		drawStatistics.drawnPrimitives += static_cast<uint32_t>(drawLists.items[alphaMode].size());
+	}
+}
+
+void vkglTF::Model::draw(VkCommandBuffer commandBuffer, const vks::Frustum& frustum, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet, uint32_t instanceCount)
+{
+	if (!buffersBound) {
+		const VkDeviceSize offsets[1] = {0};
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, getVertexBuffer(renderFlags), offsets);
+		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, indices.type);
+	}
+	if (drawLists.dirty) {
+		buildDrawLists();
+	}
+	boundMaterialSet = VK_NULL_HANDLE;
+	// Primitives with static bounds are culled by traversing the bounding volume hierarchy, the draw lists are then filtered
+	// by the resulting visibility, which keeps their material and back to front order
+	bvh.query(frustum, bvhVisibility);
+	for (uint32_t alphaMode = 0; alphaMode < 3; alphaMode++) {
+		if (skipAlphaMode(static_cast<Material::AlphaMode>(alphaMode), renderFlags)) {
+			continue;
+		}
+		for (const DrawItem& item : drawLists.items[alphaMode]) {
+			// Skinned and morphed primitives have no reliable bounds and are always drawn
+			if ((item.bvhItem != unboundedItem) && ((bvhVisibility[item.bvhItem / 32] & (1u << (item.bvhItem % 32))) == 0)) {
+				drawStatistics.culledPrimitives++;
+				continue;
+			}
+			drawPrimitive(item.primitive, commandBuffer, renderFlags, pipelineLayout, bindImageSet, instanceCount);
+			drawStatistics.drawnPrimitives++;
+		}
 	}
 }
 
@@ -1484,61 +2793,259 @@ void vkglTF::Model::getSceneDimensions()
 	dimensions.radius = glm::distance(dimensions.min, dimensions.max) / 2.0f;
 }
 
+/*
+	Returns the index of the keyframe interval [inputs[i], inputs[i + 1]] that contains time, or -1 if time is outside of the sampled range
+	The cursor is checked first together with the following interval, which covers regular playback in constant time, seeks fall back to a binary search
+*/
+int32_t vkglTF::AnimationSampler::findInterval(float time, uint32_t& cursor) const
+{
+	const size_t count = inputs.size();
+	if ((count < 2) || (time < inputs.front()) || (time > inputs.back())) {
+		return -1;
+	}
+	const uint32_t last = static_cast<uint32_t>(count - 2);
+	uint32_t i = std::min(cursor, last);
+	if (time >= inputs[i]) {
+		if (time <= inputs[i + 1]) {
+			return static_cast<int32_t>(cursor = i);
+		}
+		if ((i < last) && (time <= inputs[i + 2])) {
+			return static_cast<int32_t>(cursor = i + 1);
+		}
+	}
+	// First key greater than time, the interval starts at the key before it
+	auto upper = std::upper_bound(inputs.begin(), inputs.end(), time);
+	i = std::min(static_cast<uint32_t>(std::distance(inputs.begin(), upper)) - 1, last);
+	return static_cast<int32_t>(cursor = i);
+}
+
+/*
+	Applies all channels of the animation at the given time to their target nodes, returns true if any node was changed
+*/
+bool vkglTF::Animation::update(float time)
+{
+	bool updated = false;
+	for (auto& channel : channels) {
+		vkglTF::AnimationSampler &sampler = samplers[channel.samplerIndex];
+		if (channel.path == vkglTF::AnimationChannel::PathType::WEIGHTS) {
+			if (sampler.inputs.size() * channel.node->mesh->weights.size() > sampler.outputs.size()) {
+				continue;
+			}
+		} else if (sampler.inputs.size() > sampler.outputsVec4.size()) {
+			continue;
+		}
+
+		const int32_t i = sampler.findInterval(time, channel.keyframeCursor);
+		if (i < 0) {
+			continue;
+		}
+		float u = std::max(0.0f, time - sampler.inputs[i]) / (sampler.inputs[i + 1] - sampler.inputs[i]);
+		if (u <= 1.0f) {
+			switch (channel.path) {
+			case vkglTF::AnimationChannel::PathType::TRANSLATION: {
+				glm::vec4 trans = glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u);
+				channel.node->setTranslation(glm::vec3(trans));
+				break;
+			}
+			case vkglTF::AnimationChannel::PathType::SCALE: {
+				glm::vec4 trans = glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u);
+				channel.node->setScale(glm::vec3(trans));
+				break;
+			}
+			case vkglTF::AnimationChannel::PathType::ROTATION: {
+				glm::quat q1;
+				q1.x = sampler.outputsVec4[i].x;
+				q1.y = sampler.outputsVec4[i].y;
+				q1.z = sampler.outputsVec4[i].z;
+				q1.w = sampler.outputsVec4[i].w;
+				glm::quat q2;
+				q2.x = sampler.outputsVec4[i + 1].x;
+				q2.y = sampler.outputsVec4[i + 1].y;
+				q2.z = sampler.outputsVec4[i + 1].z;
+				q2.w = sampler.outputsVec4[i + 1].w;
+				channel.node->setRotation(glm::normalize(glm::slerp(q1, q2, u)));
+				break;
+			}
+			case vkglTF::AnimationChannel::PathType::WEIGHTS: {
+				// Outputs store the weights of all morph targets for each keyframe
+				std::vector<float>& weights = channel.node->mesh->weights;
+				const size_t weightCount = weights.size();
+				for (size_t w = 0; w < weightCount; w++) {
+					weights[w] = glm::mix(sampler.outputs[i * weightCount + w], sampler.outputs[(i + 1) * weightCount + w], u);
+				}
+				break;
+			}
+			}
+			updated = true;
+		}
+	}
+	return updated;
+}
+
 void vkglTF::Model::updateAnimation(uint32_t index, float time)
 {
+	vks::CpuProfiler::Zone zone("vkglTF::Model::updateAnimation");
 	if (index > static_cast<uint32_t>(animations.size()) - 1) {
 		std::cout << "No animation with index " << index << std::endl;
 		return;
 	}
-	Animation &animation = animations[index];
+	if (animations[index].update(time)) {
+		updateTransforms();
+		updateMorphTargets();
+	}
+}
 
-	bool updated = false;
-	for (auto& channel : animation.channels) {
-		vkglTF::AnimationSampler &sampler = animation.samplers[channel.samplerIndex];
-		if (sampler.inputs.size() > sampler.outputsVec4.size()) {
+/*
+	Updates the world matrices of all changed nodes and the uniform buffers of meshes affected by them
+	Call this after changing node transforms through Node::setTranslation, setRotation or setScale
+*/
+void vkglTF::Model::updateTransforms()
+{
+	if (!transforms.update()) {
+		return;
+	}
+	for (auto node : linearNodes) {
+		if (!node->mesh) {
 			continue;
 		}
+		bool changed = transforms.changed[node->hierarchyIndex] != 0;
+		if (!changed && node->skin) {
+			for (auto joint : node->skin->joints) {
+				if (transforms.changed[joint->hierarchyIndex]) {
+					changed = true;
+					break;
+				}
+			}
+		}
+		if (changed) {
+			node->updateMesh();
+		}
+	}
+	bvh.refit(transforms);
+	jointPalette.upload();
+}
 
-		for (auto i = 0; i < sampler.inputs.size() - 1; i++) {
-			if ((time >= sampler.inputs[i]) && (time <= sampler.inputs[i + 1])) {
-				float u = std::max(0.0f, time - sampler.inputs[i]) / (sampler.inputs[i + 1] - sampler.inputs[i]);
-				if (u <= 1.0f) {
-					switch (channel.path) {
-					case vkglTF::AnimationChannel::PathType::TRANSLATION: {
-						glm::vec4 trans = glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u);
-						channel.node->translation = glm::vec3(trans);
-						break;
-					}
-					case vkglTF::AnimationChannel::PathType::SCALE: {
-						glm::vec4 trans = glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u);
-						channel.node->scale = glm::vec3(trans);
-						break;
-					}
-					case vkglTF::AnimationChannel::PathType::ROTATION: {
-						glm::quat q1;
-						q1.x = sampler.outputsVec4[i].x;
-						q1.y = sampler.outputsVec4[i].y;
-						q1.z = sampler.outputsVec4[i].z;
-						q1.w = sampler.outputsVec4[i].w;
-						glm::quat q2;
-						q2.x = sampler.outputsVec4[i + 1].x;
-						q2.y = sampler.outputsVec4[i + 1].y;
-						q2.z = sampler.outputsVec4[i + 1].z;
-						q2.w = sampler.outputsVec4[i + 1].w;
-						channel.node->rotation = glm::normalize(glm::slerp(q1, q2, u));
-						break;
-					}
-					}
-					updated = true;
+/*
+	Gathers the targets with a non-zero weight of all meshes, call after changing Mesh::weights (done by updateAnimation for weights channels)
+	The blended vertices are written by uploadMorphTargets
+*/
+void vkglTF::Model::updateMorphTargets()
+{
+	if (morphTargets.baseVertices.empty()) {
+		return;
+	}
+	std::vector<MorphTargets::ActiveTarget> activeTargets;
+	uint32_t firstBase = 0;
+	for (auto node : linearNodes) {
+		if (!node->mesh || node->mesh->weights.empty()) {
+			continue;
+		}
+		Mesh* mesh = node->mesh;
+		// Same order as the base vertices were gathered at load time
+		for (Primitive* primitive : mesh->primitives) {
+			if (primitive->morphTargets.empty() || (primitive->vertexCount == 0)) {
+				continue;
+			}
+			for (size_t t = 0; t < primitive->morphTargets.size(); t++) {
+				const MorphTarget& target = primitive->morphTargets[t];
+				if ((mesh->weights[t] == 0.0f) || (target.deltaCount == 0)) {
+					continue;
 				}
+				activeTargets.push_back({ target.firstDelta, target.deltaCount, firstBase, mesh->weights[t] });
 			}
+			firstBase += primitive->vertexCount;
 		}
 	}
-	if (updated) {
-		for (auto &node : nodes) {
-			node->update();
+	const bool changed = (activeTargets.size() != morphTargets.activeTargets.size()) ||
+		(memcmp(activeTargets.data(), morphTargets.activeTargets.data(), activeTargets.size() * sizeof(MorphTargets::ActiveTarget)) != 0);
+	if (changed) {
+		morphTargets.activeTargets.swap(activeTargets);
+		morphTargets.version++;
+	}
+}
+
+/*
+	Creates the staging buffers for blending morph targets of models loaded with FileLoadingFlags::MorphTargets
+	frameCount is the number of frames that may be in flight (or command buffers recorded with recordMorphTargets), each one gets its own staging buffer
+*/
+void vkglTF::Model::prepareMorphTargets(uint32_t frameCount)
+{
+	if (morphTargets.baseVertices.empty() || (frameCount == 0)) {
+		return;
+	}
+
+	VkDeviceSize stagingBufferSize = morphTargets.baseVertices.size() * sizeof(Vertex);
+	if (positions.buffer != VK_NULL_HANDLE) {
+		stagingBufferSize += morphTargets.baseVertices.size() * sizeof(glm::vec3);
+	}
+	morphTargets.frames.resize(frameCount);
+	for (uint32_t i = 0; i < frameCount; i++) {
+		MorphTargets::Frame& frame = morphTargets.frames[i];
+		VK_CHECK_RESULT(device->createBuffer(
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			stagingBufferSize,
+			&frame.buffer,
+			&frame.memory));
+		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, frame.memory, 0, stagingBufferSize, 0, &frame.mapped));
+		uploadMorphTargets(i);
+	}
+}
+
+/*
+	Blends the active targets (see updateMorphTargets) into the staging buffer of the given frame, frames that already hold the current blend are skipped
+	Must only be called once the last submission of that frame's command buffer has finished executing, e.g. after VulkanExampleBase::prepareFrame
+*/
+void vkglTF::Model::uploadMorphTargets(uint32_t frame)
+{
+	vks::CpuProfiler::Zone zone("vkglTF::Model::uploadMorphTargets");
+	if ((frame >= morphTargets.frames.size()) || (morphTargets.frames[frame].version == morphTargets.version)) {
+		return;
+	}
+	MorphTargets::Frame& stagingFrame = morphTargets.frames[frame];
+	Vertex* blended = static_cast<Vertex*>(stagingFrame.mapped);
+	memcpy(blended, morphTargets.baseVertices.data(), morphTargets.baseVertices.size() * sizeof(Vertex));
+	for (const MorphTargets::ActiveTarget& target : morphTargets.activeTargets) {
+		for (uint32_t i = target.firstDelta; i < target.firstDelta + target.deltaCount; i++) {
+			const MorphTargets::Delta& delta = morphTargets.deltas[i];
+			Vertex& vertex = blended[target.firstBase + delta.vertex];
+			vertex.pos += delta.position * target.weight;
+			vertex.normal += delta.normal * target.weight;
+			vertex.tangent += glm::vec4(delta.tangent * target.weight, 0.0f);
 		}
 	}
+	if (!morphTargets.positionCopies.empty()) {
+		glm::vec3* blendedPositions = reinterpret_cast<glm::vec3*>(blended + morphTargets.baseVertices.size());
+		for (size_t i = 0; i < morphTargets.baseVertices.size(); i++) {
+			blendedPositions[i] = blended[i].pos;
+		}
+	}
+	stagingFrame.version = morphTargets.version;
+}
+
+/*
+	Records the copy of the given frame's blended vertices into the vertex buffer, must be called outside of a render pass before any pass that draws the model
+	The blend is read from the staging buffer at execution time, so pre-recorded command buffers only need uploadMorphTargets before each submission
+*/
+void vkglTF::Model::recordMorphTargets(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	if (morphTargets.vertexCopies.empty() || (frame >= morphTargets.frames.size())) {
+		return;
+	}
+
+	// Vertex reads of previously submitted frames must be finished before the buffers are overwritten
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	vkCmdCopyBuffer(commandBuffer, morphTargets.frames[frame].buffer, vertices.buffer, static_cast<uint32_t>(morphTargets.vertexCopies.size()), morphTargets.vertexCopies.data());
+	if (!morphTargets.positionCopies.empty()) {
+		vkCmdCopyBuffer(commandBuffer, morphTargets.frames[frame].buffer, positions.buffer, static_cast<uint32_t>(morphTargets.positionCopies.size()), morphTargets.positionCopies.data());
+	}
+
+	// Make the morphed vertices visible to the vertex input of all following passes
+	VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
 }
 
 /*
@@ -1558,15 +3065,9 @@ vkglTF::Node* vkglTF::Model::findNode(Node *parent, uint32_t index) {
 	return nodeFound;
 }
 
+// Returns nullptr for nodes that are not part of the loaded scene
 vkglTF::Node* vkglTF::Model::nodeFromIndex(uint32_t index) {
-	Node* nodeFound = nullptr;
-	for (auto &node : nodes) {
-		nodeFound = findNode(node, index);
-		if (nodeFound) {
-			break;
-		}
-	}
-	return nodeFound;
+	return (index < nodeTable.size()) ? nodeTable[index] : nullptr;
 }
 
 void vkglTF::Model::prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLayout descriptorSetLayout) {
@@ -1578,15 +3079,22 @@ void vkglTF::Model::prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLay
 		descriptorSetAllocInfo.descriptorSetCount = 1;
 		VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &descriptorSetAllocInfo, &node->mesh->uniformBuffer.descriptorSet));
 
-		VkWriteDescriptorSet writeDescriptorSet{};
-		writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		writeDescriptorSet.descriptorCount = 1;
-		writeDescriptorSet.dstSet = node->mesh->uniformBuffer.descriptorSet;
-		writeDescriptorSet.dstBinding = 0;
-		writeDescriptorSet.pBufferInfo = &node->mesh->uniformBuffer.descriptor;
-
-		vkUpdateDescriptorSets(device->logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
+		std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
+		writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		writeDescriptorSets[0].descriptorCount = 1;
+		writeDescriptorSets[0].dstSet = node->mesh->uniformBuffer.descriptorSet;
+		writeDescriptorSets[0].dstBinding = 0;
+		writeDescriptorSets[0].pBufferInfo = &node->mesh->uniformBuffer.descriptor;
+		// Joint palette of the model
+		writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writeDescriptorSets[1].descriptorCount = 1;
+		writeDescriptorSets[1].dstSet = node->mesh->uniformBuffer.descriptorSet;
+		writeDescriptorSets[1].dstBinding = 1;
+		writeDescriptorSets[1].pBufferInfo = &jointPalette.descriptor;
+
+		vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 	}
 	for (auto& child : node->children) {
 		prepareNodeDescriptor(child, descriptorSetLayout);
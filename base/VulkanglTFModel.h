@@ -31,6 +31,8 @@
 #endif
 #include "tiny_gltf.h"
 
+#include "frustum.hpp"
+
 #if defined(__ANDROID__)
 #include <android/asset_manager.h>
 #endif
@@ -48,6 +50,7 @@ extern VkMemoryPropertyFlags memoryPropertyFlags;
 extern uint32_t descriptorBindingFlags;
 
 struct Node;
+struct TransformHierarchy;
 
 /*
     glTF texture loading class
@@ -94,6 +97,15 @@ struct Material {
     void createDescriptorSet(VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags);
 };
 
+/*
+    glTF morph target of a primitive
+    Only vertices moved by the target are stored, as a range of Model::MorphTargets::deltas
+*/
+struct MorphTarget {
+    uint32_t firstDelta = 0;
+    uint32_t deltaCount = 0;
+};
+
 /*
     glTF primitive
 */
@@ -102,7 +114,11 @@ struct Primitive {
     uint32_t indexCount;
     uint32_t firstVertex;
     uint32_t vertexCount;
+    // Added to the indices when drawing, only non-zero if the model uses per-primitive 16-bit indices
+    int32_t vertexOffset = 0;
     Material& material;
+    // Loaded with FileLoadingFlags::MorphTargets, one per weight of the mesh
+    std::vector<MorphTarget> morphTargets;
 
     struct Dimensions {
         glm::vec3 min = glm::vec3(FLT_MAX);
@@ -113,9 +129,33 @@ struct Primitive {
     } dimensions;
 
     void setDimensions(glm::vec3 min, glm::vec3 max);
+    /** @brief Returns the axis aligned bounds of the primitive transformed by the given matrix */
+    void getBounds(const glm::mat4& matrix, glm::vec3& min, glm::vec3& max) const;
     Primitive(uint32_t firstIndex, uint32_t indexCount, Material& material) : firstIndex(firstIndex), indexCount(indexCount), material(material) {};
 };
 
+/*
+    Joint matrices of all skinned meshes of a model, stored in a single host visible storage buffer
+    Each skinned mesh owns the range given by Mesh::UniformBlock::jointOffset and jointCount, only ranges changed since the last upload are copied to the buffer
+    Bound at binding 1 of the node descriptor set (vkglTF::descriptorSetLayoutUbo):
+        layout (set = X, binding = 0) uniform UBONode { mat4 matrix; uint jointOffset; uint jointCount; } node;
+        layout (set = X, binding = 1) readonly buffer JointPalette { mat4 jointMatrices[]; };
+*/
+struct JointPalette {
+    vks::VulkanDevice* device = nullptr;
+    std::vector<glm::mat4> matrices;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDescriptorBufferInfo descriptor{};
+    void* mapped = nullptr;
+    uint32_t dirtyBegin = UINT32_MAX;
+    uint32_t dirtyEnd = 0;
+    void create(vks::VulkanDevice* device, uint32_t jointCount);
+    void markDirty(uint32_t first, uint32_t count);
+    void upload();
+    void destroy();
+};
+
 /*
     glTF mesh
 */
@@ -126,8 +166,8 @@ struct Mesh {
     std::string name;
 
     struct UniformBuffer {
-        VkBuffer buffer;
-        VkDeviceMemory memory;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
         VkDescriptorBufferInfo descriptor;
         VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
         void* mapped;
@@ -135,9 +175,13 @@ struct Mesh {
 
     struct UniformBlock {
         glm::mat4 matrix;
-        glm::mat4 jointMatrix[64]{};
-        float jointcount{ 0 };
+        // Joint matrices of skinned meshes are stored in the model's JointPalette
+        uint32_t jointOffset{ 0 };
+        uint32_t jointCount{ 0 };
     } uniformBlock;
+    JointPalette* jointPalette = nullptr;
+    // Morph target weights (glTF mesh or node weights), animated by weights channels
+    std::vector<float> weights;
 
     Mesh(vks::VulkanDevice* device, glm::mat4 matrix);
     ~Mesh();
@@ -165,23 +209,58 @@ struct Node {
     Mesh* mesh;
     Skin* skin;
     int32_t skinIndex = -1;
+    // Rest pose as loaded from the file, once the node is part of a TransformHierarchy the current values are stored there
     glm::vec3 translation{};
     glm::vec3 scale{ 1.0f };
     glm::quat rotation{};
+    TransformHierarchy* hierarchy = nullptr;
+    uint32_t hierarchyIndex = 0;
+    void setTranslation(const glm::vec3& translation);
+    void setRotation(const glm::quat& rotation);
+    void setScale(const glm::vec3& scale);
     glm::mat4 localMatrix();
     glm::mat4 getMatrix();
+    void updateMesh();
     void update();
     ~Node();
 };
 
+/*
+    Flattened node hierarchy with the local transforms and world matrices of all nodes stored in separate arrays
+    Parents are always stored before their children, so world matrices are updated in a single linear pass
+    Only nodes that have been changed and their descendants are recalculated
+*/
+struct TransformHierarchy {
+    std::vector<Node*> nodes;
+    // Index of the parent node in this hierarchy, -1 for root nodes
+    std::vector<int32_t> parents;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> matrices;
+    std::vector<glm::mat4> localMatrices;
+    std::vector<glm::mat4> worldMatrices;
+    // Local transform has been changed since the last update
+    std::vector<uint8_t> dirty;
+    // World matrix has been changed by the last update
+    std::vector<uint8_t> changed;
+    void build(const std::vector<Node*>& rootNodes);
+    void setTranslation(uint32_t index, const glm::vec3& translation);
+    void setRotation(uint32_t index, const glm::quat& rotation);
+    void setScale(uint32_t index, const glm::vec3& scale);
+    bool update();
+};
+
 /*
     glTF animation channel
 */
 struct AnimationChannel {
-    enum PathType { TRANSLATION, ROTATION, SCALE };
+    enum PathType { TRANSLATION, ROTATION, SCALE, WEIGHTS };
     PathType path;
     Node* node;
     uint32_t samplerIndex;
+    // Keyframe interval used by the last update, playback usually continues in the same or the next interval
+    uint32_t keyframeCursor = 0;
 };
 
 /*
@@ -192,6 +271,50 @@ struct AnimationSampler {
     InterpolationType interpolation;
     std::vector<float> inputs;
     std::vector<glm::vec4> outputsVec4;
+    // Scalar outputs of weights channels, one value per morph target and keyframe
+    std::vector<float> outputs;
+    int32_t findInterval(float time, uint32_t& cursor) const;
+};
+
+/*
+    Bounding volume hierarchy over the world space bounds of all primitives of a model, built with binned SAH
+    Each tree node covers a contiguous range of items, so subtrees that are fully inside the frustum are drawn without further tests
+    refit only recalculates the bounds of items whose node moved and of their ancestors, larger changes to the scene need a new build
+*/
+struct BoundingVolumeHierarchy {
+    struct Item {
+        Node* node;
+        Primitive* primitive;
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+    struct TreeNode {
+        glm::vec3 min;
+        glm::vec3 max;
+        uint32_t firstItem;
+        uint32_t itemCount;
+        // Index of the left child, the right child follows it, zero for leaves
+        uint32_t children;
+        uint32_t parent;
+    };
+    std::vector<TreeNode> nodes;
+    std::vector<Item> items;
+    // Skinned and morphed primitives may leave their rest pose bounds, so they are not part of the tree and always visible
+    std::vector<Item> unboundedItems;
+    void build(const std::vector<Node*>& sceneNodes, bool preTransformed);
+    void refit(const TransformHierarchy& transforms);
+    // Sets one bit per visible item (bit i % 32 of word i / 32, same layout as vks::Frustum::checkBoxes) and returns the number of visible items
+    uint32_t query(const vks::Frustum& frustum, std::vector<uint32_t>& visibility);
+private:
+    bool preTransformed = false;
+    // Leaf containing each item
+    std::vector<uint32_t> itemLeaves;
+    std::vector<uint8_t> dirtyNodes;
+    std::vector<uint32_t> refitNodes;
+    std::vector<std::pair<uint32_t, uint8_t>> traversalStack;
+    void updateItemBounds(Item& item) const;
+    void updateNodeBounds(uint32_t index);
+    void split(uint32_t index, uint32_t firstItem, uint32_t itemCount);
 };
 
 /*
@@ -203,6 +326,7 @@ struct Animation {
     std::vector<AnimationChannel> channels;
     float start = std::numeric_limits<float>::max();
     float end = std::numeric_limits<float>::min();
+    bool update(float time);
 };
 
 /*
@@ -228,19 +352,66 @@ struct Vertex {
     static VkPipelineVertexInputStateCreateInfo* getPipelineVertexInputState(const std::vector<VertexComponent> components);
 };
 
+/*
+    Packed vertex layout used with FileLoadingFlags::PackedVertices
+    Only stores the components listed in vkglTF::packedVertexComponents, tightly packed in that order:
+    Position: float3, Normal: octahedral snorm16x2, UV: half2, Color: unorm8x4
+    Tangent: octahedral snorm16x2 + handedness (snorm16x4), Joint0: uint8x4 (up to 256 joints, models with more use the default layout), Weight0: unorm8x4
+    Shaders read joints as uvec4 and need to decode normals and tangents:
+        vec3 n = vec3(oct.xy, 1.0 - abs(oct.x) - abs(oct.y));
+        if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n = normalize(n);
+*/
+struct PackedVertex {
+    static VkVertexInputBindingDescription vertexInputBindingDescription;
+    static std::vector<VkVertexInputAttributeDescription> vertexInputAttributeDescriptions;
+    static VkPipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo;
+    static uint32_t componentSize(VertexComponent component);
+    static uint32_t stride(const std::vector<VertexComponent>& components);
+    static void pack(const Vertex& vertex, const std::vector<VertexComponent>& components, uint8_t* dst);
+    static VkVertexInputBindingDescription inputBindingDescription(uint32_t binding, const std::vector<VertexComponent>& components);
+    static std::vector<VkVertexInputAttributeDescription> inputAttributeDescriptions(uint32_t binding, const std::vector<VertexComponent> components);
+    /** @brief Returns the pipeline vertex input state create info structure for a model loaded with the given packed vertex components */
+    static VkPipelineVertexInputStateCreateInfo* getPipelineVertexInputState(const std::vector<VertexComponent> components);
+};
+
+// Vertex components written by FileLoadingFlags::PackedVertices, needs to be set before loading and match the components passed to PackedVertex::getPipelineVertexInputState
+extern std::vector<VertexComponent> packedVertexComponents;
+// Vertices are welded if all their attributes round to the same multiple of this value, zero only merges bitwise identical vertices
+extern float vertexWeldEpsilon;
+
 enum FileLoadingFlags {
     None = 0x00000000,
     PreTransformVertices = 0x00000001,
     PreMultiplyVertexColors = 0x00000002,
     FlipY = 0x00000004,
-    DontLoadImages = 0x00000008
+    DontLoadImages = 0x00000008,
+    // Memory map the glTF/glb and its .bin files and read accessors directly from the mapping instead of copying buffers to the heap
+    MemoryMappedBuffers = 0x00000010,
+    // Decode PNG/JPEG images on worker threads and upload them while the remaining images are still being decoded
+    ParallelImageDecoding = 0x00000020,
+    // Store vertices in the compact PackedVertex layout, limited to vkglTF::packedVertexComponents
+    PackedVertices = 0x00000040,
+    // Additionally create a tightly packed position only vertex buffer for depth only passes (see RenderFlags::DepthOnly)
+    PositionOnlyStream = 0x00000080,
+    // Reorder triangles and vertices of each primitive for vertex cache locality, reduced overdraw and linear vertex fetches
+    OptimizeMeshes = 0x00000100,
+    // Merge identical vertices within each primitive, see vkglTF::vertexWeldEpsilon
+    WeldVertices = 0x00000200,
+    // Load morph targets and weights animation channels, blended by Model::uploadMorphTargets (uses the default vertex layout)
+    MorphTargets = 0x00000800,
+    // Use 16-bit indices relative to Primitive::vertexOffset for models with more than 65535 vertices if every primitive fits
+    // Only for apps that draw through Model::draw or drawNode, drawing the whole index buffer with a single vkCmdDrawIndexed requires absolute indices
+    RelativeIndices16 = 0x00001000
 };
 
 enum RenderFlags {
     BindImages = 0x00000001,
     RenderOpaqueNodes = 0x00000002,
     RenderAlphaMaskedNodes = 0x00000004,
-    RenderAlphaBlendedNodes = 0x00000008
+    RenderAlphaBlendedNodes = 0x00000008,
+    // Bind the position only vertex stream (if present), pipelines need to use PackedVertex::getPipelineVertexInputState({ VertexComponent::Position })
+    DepthOnly = 0x00000010
 };
 
 /*
@@ -251,23 +422,89 @@ private:
     vkglTF::Texture* getTexture(uint32_t index);
     vkglTF::Texture emptyTexture;
     void createEmptyTexture(VkQueue transferQueue);
+    // Base address of each glTF buffer while loading (either the tinygltf buffer data or a memory mapped file)
+    std::vector<const unsigned char*> bufferData;
+    const unsigned char* getAccessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor) const;
+    void getAccessorVec3(const tinygltf::Model& model, const tinygltf::Accessor& accessor, std::vector<glm::vec3>& values) const;
+    const VkBuffer* getVertexBuffer(uint32_t renderFlags) const;
+    // Set from FileLoadingFlags::MorphTargets while loading nodes
+    bool morphTargetsEnabled = false;
+    // Vertices have been transformed to world space at load time (FileLoadingFlags::PreTransformVertices)
+    bool preTransformed = false;
 public:
-    vks::VulkanDevice* device;
-    VkDescriptorPool descriptorPool;
+    vks::VulkanDevice* device = nullptr;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
 
     struct Vertices {
         int count;
-        VkBuffer buffer;
-        VkDeviceMemory memory;
+        // Size of a single vertex, differs from sizeof(Vertex) for models loaded with FileLoadingFlags::PackedVertices
+        uint32_t stride = sizeof(Vertex);
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
     } vertices;
+    /*
+        16-bit indices are selected automatically if all vertices of the model can be addressed with them
+        Larger models loaded with FileLoadingFlags::RelativeIndices16 still use 16-bit indices if every primitive fits, with indices relative to Primitive::vertexOffset
+        Index buffers of models with shader accessible buffers (see vkglTF::memoryPropertyFlags) always use 32-bit indices
+    */
     struct Indices {
         int count;
-        VkBuffer buffer;
-        VkDeviceMemory memory;
+        VkIndexType type = VK_INDEX_TYPE_UINT32;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
     } indices;
+    // Position only copy of the vertex buffer, created with FileLoadingFlags::PositionOnlyStream
+    struct Positions {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+    } positions;
+    /*
+        Morph targets (FileLoadingFlags::MorphTargets)
+        Deltas of all targets are stored sparse, with one entry per vertex moved by a target
+        uploadMorphTargets restores the base vertices of all morphed primitives and then adds the deltas of targets with a non-zero weight only,
+        so the cost scales with the number of active targets instead of all targets of the model
+        The blended vertices are written to a staging buffer per frame and copied into the vertex buffer by recordMorphTargets
+    */
+    struct MorphTargets {
+        struct Delta {
+            // Relative to Primitive::firstVertex
+            uint32_t vertex;
+            glm::vec3 position;
+            glm::vec3 normal;
+            glm::vec3 tangent;
+        };
+        std::vector<Delta> deltas;
+        // Unmodified vertices of all morphed primitives, stored consecutively
+        std::vector<Vertex> baseVertices;
+        // Target with a non-zero weight, deltas are added to the base vertices starting at firstBase
+        struct ActiveTarget {
+            uint32_t firstDelta;
+            uint32_t deltaCount;
+            uint32_t firstBase;
+            float weight;
+        };
+        std::vector<ActiveTarget> activeTargets;
+        // Copies from the staging buffer into the vertex buffer and position only stream, adjacent primitives are merged
+        std::vector<VkBufferCopy> vertexCopies;
+        std::vector<VkBufferCopy> positionCopies;
+        // Incremented whenever the weights changed, frames with an older blend are updated by uploadMorphTargets
+        uint32_t version = 0;
+        // One host visible staging buffer per frame in flight, so vertices of a frame still executing on the GPU aren't overwritten
+        struct Frame {
+            VkBuffer buffer = VK_NULL_HANDLE;
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            void* mapped = nullptr;
+            uint32_t version = UINT32_MAX;
+        };
+        std::vector<Frame> frames;
+    } morphTargets;
 
     std::vector<Node*> nodes;
     std::vector<Node*> linearNodes;
+    // glTF node index to node, filled by loadNode
+    std::vector<Node*> nodeTable;
+    TransformHierarchy transforms;
+    JointPalette jointPalette;
 
     std::vector<Skin*> skins;
 
@@ -283,24 +520,78 @@ public:
         float radius;
     } dimensions;
 
+    // Built at load time and refit by updateTransforms, used by the frustum culled draw
+    BoundingVolumeHierarchy bvh;
+    // Visibility of the bvh items for the current frustum culled draw
+    std::vector<uint32_t> bvhVisibility;
+    /*
+        Flat per Material::AlphaMode primitive lists used by draw, so a pass only visits the primitives it renders
+        Opaque and masked primitives are sorted by material to minimize descriptor set binds, blended primitives are sorted back to front by sortBlendedPrimitives
+        The lists are built on the first draw and rebuilt after invalidateDrawLists, e.g. when nodes or meshes have been added or removed
+    */
+    struct DrawItem {
+        Node* node;
+        Primitive* primitive;
+        float viewDistance;
+        // Index of the primitive in bvh.items, unboundedItem for primitives that are not part of the tree and always drawn
+        uint32_t bvhItem;
+    };
+    static const uint32_t unboundedItem = ~0u;
+    struct DrawLists {
+        std::vector<DrawItem> items[3];
+        bool dirty = true;
+    } drawLists;
+    // Accumulated over all draw calls since the last resetDrawStatistics, usually called once per frame (or command buffer recording)
+    struct DrawStatistics {
+        uint32_t drawnPrimitives = 0;
+        uint32_t culledPrimitives = 0;
+        uint32_t drawCalls = 0;
+        uint32_t descriptorSetBinds = 0;
+    } drawStatistics;
+    // Vertex cache statistics of all primitives before and after FileLoadingFlags::OptimizeMeshes, see vks::meshoptimizer::VertexCacheStatistics
+    struct OptimizationStatistics {
+        float acmrBefore = 0.0f;
+        float acmrAfter = 0.0f;
+        float atvrBefore = 0.0f;
+        float atvrAfter = 0.0f;
+        uint32_t triangles = 0;
+    } optimizationStatistics;
+
     bool metallicRoughnessWorkflow = true;
     bool buffersBound = false;
+    // Material descriptor set bound by the current draw call, used to skip redundant binds
+    VkDescriptorSet boundMaterialSet = VK_NULL_HANDLE;
     std::string path;
 
     Model() {};
     ~Model();
     void loadNode(vkglTF::Node* parent, const tinygltf::Node& node, uint32_t nodeIndex, const tinygltf::Model& model, std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer, float globalscale);
     void loadSkins(tinygltf::Model& gltfModel);
-    void loadImages(tinygltf::Model& gltfModel, vks::VulkanDevice* device, VkQueue transferQueue);
+    void weldVertices(std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer);
+    void optimizeMeshes(std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer);
+    void loadImages(tinygltf::Model& gltfModel, vks::VulkanDevice* device, VkQueue transferQueue, bool parallelDecoding = false);
     void loadMaterials(tinygltf::Model& gltfModel);
     void loadAnimations(tinygltf::Model& gltfModel);
     void loadFromFile(std::string filename, vks::VulkanDevice* device, VkQueue transferQueue, uint32_t fileLoadingFlags = vkglTF::FileLoadingFlags::None, float scale = 1.0f);
-    void bindBuffers(VkCommandBuffer commandBuffer);
-    void drawNode(Node* node, VkCommandBuffer commandBuffer, uint32_t renderFlags = 0, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindImageSet = 1, uint32_t instanceCount = 1);
+    void bindBuffers(VkCommandBuffer commandBuffer, uint32_t renderFlags = 0);
+    void drawNode(Node* node, VkCommandBuffer commandBuffer, uint32_t renderFlags = 0, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindImageSet = 1, uint32_t instanceCount = 1, const vks::Frustum* frustum = nullptr);
     void draw(VkCommandBuffer commandBuffer, uint32_t renderFlags = 0, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindImageSet = 1, uint32_t instanceCount = 1);
+    /** @brief Draws only primitives whose bounds intersect the given world space frustum (e.g. updated with projection * view), see drawStatistics */
+    void draw(VkCommandBuffer commandBuffer, const vks::Frustum& frustum, uint32_t renderFlags = 0, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindImageSet = 1, uint32_t instanceCount = 1);
+    bool isPrimitiveVisible(Node* node, Primitive* primitive, const vks::Frustum& frustum);
+    void drawPrimitive(Primitive* primitive, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet, uint32_t instanceCount);
+    void buildDrawLists();
+    void invalidateDrawLists();
+    void sortBlendedPrimitives(const glm::vec3& viewPosition);
+    void resetDrawStatistics();
     void getNodeDimensions(Node* node, glm::vec3& min, glm::vec3& max);
     void getSceneDimensions();
     void updateAnimation(uint32_t index, float time);
+    void updateTransforms();
+    void updateMorphTargets();
+    void prepareMorphTargets(uint32_t frameCount = 1);
+    void uploadMorphTargets(uint32_t frame);
+    void recordMorphTargets(VkCommandBuffer commandBuffer, uint32_t frame = 0);
     Node* findNode(Node* parent, uint32_t index);
     Node* nodeFromIndex(uint32_t index);
     void prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLayout descriptorSetLayout);
@@ -13,6 +13,11 @@
 #include <functional>
 #include <chrono>
 #include <iomanip>
+#include <numeric>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <cmath>
 
 namespace vks
 {
@@ -31,6 +36,39 @@ namespace vks
 
 		double runtime = 0.0;
 		uint32_t frameCount = 0;
+		// True once the warmup phase is over
+		bool measuring = false;
+		// Time from the start of preparation to the end of the first frame (ms), set by the caller before run()
+		double startupTime = 0.0;
+		// True if pipelines were created from a pipeline cache loaded from disk
+		bool pipelineCacheWarm = false;
+		// Average GPU time per named pass (ms), set by the caller after run() if the example uses a GPU profiler
+		std::vector<std::pair<std::string, double>> passTimes;
+
+		// Frame time distribution of the benchmark phase (ms), calculated at the end of run()
+		struct Statistics {
+			double min = 0.0;
+			double max = 0.0;
+			double mean = 0.0;
+			double stddev = 0.0;
+			double p50 = 0.0;
+			double p90 = 0.0;
+			double p99 = 0.0;
+			double p999 = 0.0;
+			// Frames slower than the third quartile plus 1.5 times the interquartile range
+			uint32_t outliers = 0;
+		} statistics;
+
+		// Run description for the JSON report, set by the caller
+		std::string exampleName;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::string gitRevision = "unknown";
+
+		// JSON report of an earlier run to compare against, metrics slower by more than regressionThreshold percent are reported as regressions
+		std::string baselineFilename = "";
+		double regressionThreshold = 5.0;
+		std::vector<std::string> regressions;
 
 		void run(std::function<void()> renderFunc, VkPhysicalDeviceProperties deviceProps) {
 			active = true;
@@ -45,16 +83,22 @@ namespace vks
 			// Warm up phase to get more stable frame rates
 			{
 				double tMeasured = 0.0;
+				bool firstFrame = true;
 				while (tMeasured < (warmup * 1000)) {
 					auto tStart = std::chrono::high_resolution_clock::now();
 					renderFunc();
 					auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
 					tMeasured += tDiff;
+					if (firstFrame) {
+						startupTime += tDiff;
+						firstFrame = false;
+					}
 				};
 			}
 
 			// Benchmark phase
 			{
+				measuring = true;
 				while (runtime < (duration * 1000.0)) {
 					auto tStart = std::chrono::high_resolution_clock::now();
 					renderFunc();
@@ -69,16 +113,229 @@ namespace vks
 				std::cout << "runtime: " << (runtime / 1000.0) << "\n";
 				std::cout << "frames : " << frameCount << "\n";
 				std::cout << "fps    : " << frameCount / (runtime / 1000.0) << "\n";
+				std::cout << "startup: " << startupTime << " ms (" << (pipelineCacheWarm ? "warm" : "cold") << " pipeline cache)" << "\n";
+				calculateStatistics();
+				std::cout << "p50    : " << statistics.p50 << " ms" << "\n";
+				std::cout << "p90    : " << statistics.p90 << " ms" << "\n";
+				std::cout << "p99    : " << statistics.p99 << " ms" << "\n";
+				std::cout << "p99.9  : " << statistics.p999 << " ms" << "\n";
+				std::cout << "stddev : " << statistics.stddev << " ms" << "\n";
+				std::cout << "outlier: " << statistics.outliers << " frames" << "\n";
+			}
+		}
+
+		// Percentile of sorted values, interpolating linearly between the closest ranks
+		static double percentile(const std::vector<double>& sorted, double p) {
+			if (sorted.empty()) {
+				return 0.0;
+			}
+			const double rank = p / 100.0 * (sorted.size() - 1);
+			const size_t lower = static_cast<size_t>(rank);
+			const size_t upper = std::min(lower + 1, sorted.size() - 1);
+			return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - lower);
+		}
+
+		void calculateStatistics() {
+			statistics = Statistics();
+			if (frameTimes.empty()) {
+				return;
+			}
+			std::vector<double> sorted(frameTimes);
+			std::sort(sorted.begin(), sorted.end());
+			statistics.min = sorted.front();
+			statistics.max = sorted.back();
+			statistics.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+			double variance = 0.0;
+			for (double t : sorted) {
+				variance += (t - statistics.mean) * (t - statistics.mean);
+			}
+			statistics.stddev = std::sqrt(variance / sorted.size());
+			statistics.p50 = percentile(sorted, 50.0);
+			statistics.p90 = percentile(sorted, 90.0);
+			statistics.p99 = percentile(sorted, 99.0);
+			statistics.p999 = percentile(sorted, 99.9);
+			const double q1 = percentile(sorted, 25.0);
+			const double q3 = percentile(sorted, 75.0);
+			const double outlierLimit = q3 + 1.5 * (q3 - q1);
+			statistics.outliers = static_cast<uint32_t>(sorted.end() - std::upper_bound(sorted.begin(), sorted.end(), outlierLimit));
+		}
+
+		// Metrics compared against a baseline, all of them are times (lower is better)
+		std::vector<std::pair<std::string, double>> getMetrics() const {
+			std::vector<std::pair<std::string, double>> metrics = {
+				{ "mean_ms", statistics.mean },
+				{ "p50_ms", statistics.p50 },
+				{ "p90_ms", statistics.p90 },
+				{ "p99_ms", statistics.p99 },
+				{ "p999_ms", statistics.p999 },
+			};
+			return metrics;
+		}
+
+		static std::string escapeJson(const std::string& value) {
+			std::string escaped;
+			for (char c : value) {
+				if ((c == '"') || (c == '\\')) {
+					escaped += '\\';
+				}
+				escaped += c;
+			}
+			return escaped;
+		}
+
+		/*
+			Reads the numeric members of a flat object (e.g. "metrics") from a JSON report written by saveResults
+			This is not a general JSON parser, it only needs to understand the reports written by this class
+		*/
+		static bool readJsonNumbers(const std::string& json, const std::string& object, std::map<std::string, double>& values) {
+			size_t pos = json.find("\"" + object + "\"");
+			if (pos == std::string::npos) {
+				return false;
+			}
+			pos = json.find('{', pos);
+			const size_t end = json.find('}', pos);
+			if ((pos == std::string::npos) || (end == std::string::npos)) {
+				return false;
+			}
+			while (true) {
+				const size_t keyStart = json.find('"', pos);
+				if ((keyStart == std::string::npos) || (keyStart > end)) {
+					break;
+				}
+				const size_t keyEnd = json.find('"', keyStart + 1);
+				const size_t colon = json.find(':', keyEnd);
+				values[json.substr(keyStart + 1, keyEnd - keyStart - 1)] = std::strtod(json.c_str() + colon + 1, nullptr);
+				pos = json.find_first_of(",}", colon);
+			}
+			return true;
+		}
+
+		/*
+			Compares frame time metrics and GPU pass times against the report in baselineFilename
+			Returns false if the baseline can't be read, regressions are printed and stored in regressions
+		*/
+		bool compareWithBaseline() {
+			regressions.clear();
+			std::ifstream file(baselineFilename);
+			if (!file.is_open()) {
+				std::cerr << "Could not open benchmark baseline " << baselineFilename << "\n";
+				return false;
 			}
+			std::stringstream buffer;
+			buffer << file.rdbuf();
+			const std::string json = buffer.str();
+			std::map<std::string, double> baselineMetrics, baselinePasses;
+			if (!readJsonNumbers(json, "metrics", baselineMetrics)) {
+				std::cerr << "Benchmark baseline " << baselineFilename << " contains no metrics\n";
+				return false;
+			}
+			readJsonNumbers(json, "passes", baselinePasses);
+			std::cout << "baseline: " << baselineFilename << " (threshold " << regressionThreshold << "%)" << "\n";
+			auto compare = [&](const std::string& name, double value, const std::map<std::string, double>& baseline) {
+				auto it = baseline.find(name);
+				if ((it == baseline.end()) || (it->second <= 0.0)) {
+					return;
+				}
+				const double change = (value - it->second) / it->second * 100.0;
+				const bool regressed = change > regressionThreshold;
+				std::cout << (regressed ? "REGRESSION " : "           ") << name << ": " << it->second << " -> " << value << " ms (" << std::showpos << change << std::noshowpos << "%)" << "\n";
+				if (regressed) {
+					regressions.push_back(name);
+				}
+			};
+			for (auto& metric : getMetrics()) {
+				compare(metric.first, metric.second, baselineMetrics);
+			}
+			for (auto& passTime : passTimes) {
+				compare(passTime.first, passTime.second, baselinePasses);
+			}
+			return true;
+		}
+
+		void printPassTimes() {
+			for (auto& passTime : passTimes) {
+				std::cout << "gpu    : " << passTime.first << " " << passTime.second << " ms" << "\n";
+			}
+		}
+
+		void saveJson() {
+			std::ofstream result(filename, std::ios::out);
+			if (!result.is_open()) {
+				return;
+			}
+			result << std::fixed << std::setprecision(4);
+			result << "{\n";
+			result << "  \"example\": \"" << escapeJson(exampleName) << "\",\n";
+			result << "  \"device\": \"" << escapeJson(deviceProps.deviceName) << "\",\n";
+			result << "  \"driverversion\": " << deviceProps.driverVersion << ",\n";
+			result << "  \"width\": " << width << ",\n";
+			result << "  \"height\": " << height << ",\n";
+			result << "  \"revision\": \"" << escapeJson(gitRevision) << "\",\n";
+			result << "  \"duration_ms\": " << runtime << ",\n";
+			result << "  \"frames\": " << frameCount << ",\n";
+			result << "  \"fps\": " << frameCount / (runtime / 1000.0) << ",\n";
+			result << "  \"startup_ms\": " << startupTime << ",\n";
+			result << "  \"pipelinecache\": \"" << (pipelineCacheWarm ? "warm" : "cold") << "\",\n";
+			result << "  \"metrics\": {\n";
+			result << "    \"min_ms\": " << statistics.min << ",\n";
+			result << "    \"max_ms\": " << statistics.max << ",\n";
+			result << "    \"stddev_ms\": " << statistics.stddev << ",\n";
+			result << "    \"outliers\": " << statistics.outliers;
+			for (auto& metric : getMetrics()) {
+				result << ",\n    \"" << metric.first << "\": " << metric.second;
+			}
+			result << "\n  },\n";
+			result << "  \"passes\": {";
+			for (size_t i = 0; i < passTimes.size(); i++) {
+				result << (i > 0 ? "," : "") << "\n    \"" << escapeJson(passTimes[i].first) << "\": " << passTimes[i].second;
+			}
+			result << (passTimes.empty() ? "},\n" : "\n  },\n");
+			result << "  \"baseline\": \"" << escapeJson(baselineFilename) << "\",\n";
+			result << "  \"regressions\": [";
+			for (size_t i = 0; i < regressions.size(); i++) {
+				result << (i > 0 ? ", " : "") << "\"" << escapeJson(regressions[i]) << "\"";
+			}
+			result << "]";
+			if (outputFrameTimes) {
+				result << ",\n  \"frametimes_ms\": [";
+				for (size_t i = 0; i < frameTimes.size(); i++) {
+					result << (i > 0 ? ", " : "") << frameTimes[i];
+				}
+				result << "]";
+			}
+			result << "\n}\n";
 		}
 
+		// Results are written as a JSON report if the file name ends with .json, and as CSV otherwise
 		void saveResults() {
+			const std::string jsonExtension = ".json";
+			if ((filename.size() >= jsonExtension.size()) && (filename.compare(filename.size() - jsonExtension.size(), jsonExtension.size(), jsonExtension) == 0)) {
+				saveJson();
+#if defined(_WIN32)
+				FreeConsole();
+#endif
+				return;
+			}
 			std::ofstream result(filename, std::ios::out);
 			if (result.is_open()) {
 				result << std::fixed << std::setprecision(4);
 
-				result << "device,driverversion,duration (ms),frames,fps" << "\n";
-				result << deviceProps.deviceName << "," << deviceProps.driverVersion << "," << runtime << "," << frameCount << "," << frameCount / (runtime / 1000.0) << "\n";
+				result << "device,driverversion,duration (ms),frames,fps,startup (ms),pipeline cache" << "\n";
+				result << deviceProps.deviceName << "," << deviceProps.driverVersion << "," << runtime << "," << frameCount << "," << frameCount / (runtime / 1000.0) << "," << startupTime << "," << (pipelineCacheWarm ? "warm" : "cold") << "\n";
+
+				result << "\n" << "statistic,value" << "\n";
+				result << "stddev," << statistics.stddev << "\n";
+				result << "outliers," << statistics.outliers << "\n";
+				for (auto& metric : getMetrics()) {
+					result << metric.first << "," << metric.second << "\n";
+				}
+
+				if (!passTimes.empty()) {
+					result << "\n" << "pass,gpu (ms)" << "\n";
+					for (auto& passTime : passTimes) {
+						result << passTime.first << "," << passTime.second << "\n";
+					}
+				}
 
 				if (outputFrameTimes) {
 					result << "\n" << "frame,ms" << "\n";
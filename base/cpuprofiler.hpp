@@ -0,0 +1,191 @@
+/*
+* Scoped CPU profiler zones with Chrome trace export
+*
+* Copyright (C) 2026 by the games106 contributors
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vks
+{
+	/*
+		Zones are recorded into a buffer owned by the calling thread, so recording never takes a lock
+		(only the first zone of a thread registers its buffer). Profiling is disabled until enable() is called,
+		which reduces a zone to a single atomic load. Nested zones are shown as a hierarchy by the trace viewers.
+
+		Usage: vks::CpuProfiler::Zone zone("updateUniformBuffers");
+		Zone names must outlive the profiler (e.g. string literals), as only the pointer is stored.
+	*/
+	class CpuProfiler
+	{
+		struct ThreadBuffer;
+	public:
+		class Zone
+		{
+		public:
+			explicit Zone(const char* name) : name(name)
+			{
+				if (CpuProfiler::isEnabled()) {
+					buffer = &CpuProfiler::threadBuffer();
+					begin = CpuProfiler::now();
+				}
+			}
+			~Zone()
+			{
+				if (buffer) {
+					buffer->add(name, begin, CpuProfiler::now());
+				}
+			}
+		private:
+			const char* name;
+			int64_t begin = 0;
+			ThreadBuffer* buffer = nullptr;
+			Zone(const Zone&);
+			Zone& operator=(const Zone&);
+		};
+
+		static void enable()
+		{
+			enabledFlag().store(true, std::memory_order_relaxed);
+		}
+
+		static bool isEnabled()
+		{
+			return enabledFlag().load(std::memory_order_relaxed);
+		}
+
+		/*
+			Name shown for the calling thread in the trace viewer, threads without a name are listed by index
+			Does nothing while profiling is disabled, so it's safe to call for every worker thread
+		*/
+		static void setThreadName(const std::string& name)
+		{
+			if (!isEnabled()) {
+				return;
+			}
+			threadBuffer().name = name;
+		}
+
+		/*
+			Writes all recorded zones in the Chrome trace event format, which can be opened with chrome://tracing or ui.perfetto.dev
+			Must not be called while other threads are still recording zones (e.g. call it at shutdown)
+		*/
+		static bool writeTrace(const std::string& filename)
+		{
+			std::ofstream file(filename, std::ios::out);
+			if (!file.is_open()) {
+				return false;
+			}
+			std::lock_guard<std::mutex> lock(registryMutex());
+			file << std::fixed << std::setprecision(3);
+			file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+			bool first = true;
+			for (auto& buffer : registry()) {
+				file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":\"" << escape(buffer->name.empty() ? "thread " + std::to_string(buffer->id) : buffer->name) << "\"}}";
+				first = false;
+				for (auto& event : buffer->events) {
+					file << ",\n{\"name\":\"" << escape(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id << ",\"ts\":" << event.begin / 1000.0 << ",\"dur\":" << (event.end - event.begin) / 1000.0 << "}";
+				}
+				if (buffer->dropped > 0) {
+					std::cerr << "CpuProfiler: " << buffer->dropped << " zones of thread " << buffer->id << " were dropped (buffer full)\n";
+				}
+			}
+			file << "\n]}\n";
+			return true;
+		}
+
+	private:
+		struct Event
+		{
+			const char* name;
+			int64_t begin;
+			int64_t end;
+		};
+
+		struct ThreadBuffer
+		{
+			// Upper limit for the number of zones per thread, so long running sessions don't grow without bounds
+			static const size_t maxEvents = 1 << 20;
+			uint32_t id = 0;
+			std::string name;
+			std::vector<Event> events;
+			uint64_t dropped = 0;
+			void add(const char* name, int64_t begin, int64_t end)
+			{
+				if (events.capacity() == 0) {
+					// Allocated with the first zone, threads that only set their name don't reserve any event storage
+					events.reserve(4096);
+				}
+				if (events.size() < maxEvents) {
+					events.push_back({ name, begin, end });
+				} else {
+					dropped++;
+				}
+			}
+		};
+
+		static std::atomic<bool>& enabledFlag()
+		{
+			static std::atomic<bool> enabled(false);
+			return enabled;
+		}
+
+		static std::mutex& registryMutex()
+		{
+			static std::mutex mutex;
+			return mutex;
+		}
+
+		// Buffers are shared with the registry, so zones of threads that have already exited are still written
+		static std::vector<std::shared_ptr<ThreadBuffer>>& registry()
+		{
+			static std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+			return buffers;
+		}
+
+		static ThreadBuffer& threadBuffer()
+		{
+			static thread_local ThreadBuffer* buffer = nullptr;
+			if (!buffer) {
+				std::lock_guard<std::mutex> lock(registryMutex());
+				std::shared_ptr<ThreadBuffer> newBuffer = std::make_shared<ThreadBuffer>();
+				newBuffer->id = static_cast<uint32_t>(registry().size());
+				registry().push_back(newBuffer);
+				buffer = newBuffer.get();
+			}
+			return *buffer;
+		}
+
+		// Nanoseconds since the first call
+		static int64_t now()
+		{
+			static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		static std::string escape(const std::string& value)
+		{
+			std::string escaped;
+			for (char c : value) {
+				if ((c == '"') || (c == '\\')) {
+					escaped += '\\';
+				}
+				escaped += c;
+			}
+			return escaped;
+		}
+	};
+}
@@ -6,16 +6,74 @@
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
+#pragma once
+
 #include <array>
+#include <algorithm>
+#include <cstdint>
 #include <math.h>
 #include <glm/glm.hpp>
 
+// Batch tests use the widest instruction set enabled for the build (e.g. -mavx2 or /arch:AVX2) and fall back to scalar code
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VKS_FRUSTUM_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define VKS_FRUSTUM_SSE2
+#endif
+
 namespace vks
 {
+	// Lane types for the batch culling kernels, all compares return one bit per lane
+	namespace frustumlanes
+	{
+		struct Scalar
+		{
+			typedef float type;
+			enum { width = 1 };
+			static type load(const float* p) { return *p; }
+			static type set(float v) { return v; }
+			static type madd(type a, type b, type c) { return a * b + c; }
+			static type negate(type a) { return -a; }
+			static uint32_t lessThan(type a, type b) { return (a < b) ? 1 : 0; }
+			static uint32_t lessEqual(type a, type b) { return (a <= b) ? 1 : 0; }
+		};
+#if defined(VKS_FRUSTUM_AVX2)
+		struct Simd
+		{
+			typedef __m256 type;
+			enum { width = 8 };
+			static type load(const float* p) { return _mm256_loadu_ps(p); }
+			static type set(float v) { return _mm256_set1_ps(v); }
+			static type madd(type a, type b, type c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+			static type negate(type a) { return _mm256_sub_ps(_mm256_setzero_ps(), a); }
+			static uint32_t lessThan(type a, type b) { return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ))); }
+			static uint32_t lessEqual(type a, type b) { return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ))); }
+		};
+#elif defined(VKS_FRUSTUM_SSE2)
+		struct Simd
+		{
+			typedef __m128 type;
+			enum { width = 4 };
+			static type load(const float* p) { return _mm_loadu_ps(p); }
+			static type set(float v) { return _mm_set1_ps(v); }
+			static type madd(type a, type b, type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+			static type negate(type a) { return _mm_sub_ps(_mm_setzero_ps(), a); }
+			static uint32_t lessThan(type a, type b) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(a, b))); }
+			static uint32_t lessEqual(type a, type b) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(a, b))); }
+		};
+#else
+		typedef Scalar Simd;
+#endif
+	}
+
 	class Frustum
 	{
 	public:
 		enum side { LEFT = 0, RIGHT = 1, TOP = 2, BOTTOM = 3, BACK = 4, FRONT = 5 };
+		// Plane mask with all planes set, see checkSpheres and checkBoxes
+		enum { ALL_PLANES = 0x3F };
 		std::array<glm::vec4, 6> planes;
 
 		void update(glm::mat4 matrix)
@@ -68,5 +126,163 @@ namespace vks
 			}
 			return true;
 		}
+
+		// Tests an axis aligned bounding box against all planes using the box corner furthest along each plane normal
+		bool checkBox(glm::vec3 min, glm::vec3 max) const
+		{
+			for (size_t i = 0; i < planes.size(); i++)
+			{
+				glm::vec3 p(planes[i].x >= 0.0f ? max.x : min.x, planes[i].y >= 0.0f ? max.y : min.y, planes[i].z >= 0.0f ? max.z : min.z);
+				if ((planes[i].x * p.x) + (planes[i].y * p.y) + (planes[i].z * p.z) + planes[i].w < 0.0f)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Plane coherent variant for hierarchical tests, only tests the planes in planeMask and replaces it with the planes the box intersects
+		bool checkBox(glm::vec3 min, glm::vec3 max, uint8_t& planeMask) const
+		{
+			uint8_t intersected = 0;
+			for (size_t i = 0; i < planes.size(); i++)
+			{
+				if ((planeMask & (1 << i)) == 0)
+				{
+					continue;
+				}
+				glm::vec3 outer(planes[i].x >= 0.0f ? max.x : min.x, planes[i].y >= 0.0f ? max.y : min.y, planes[i].z >= 0.0f ? max.z : min.z);
+				if ((planes[i].x * outer.x) + (planes[i].y * outer.y) + (planes[i].z * outer.z) + planes[i].w < 0.0f)
+				{
+					return false;
+				}
+				glm::vec3 inner(planes[i].x >= 0.0f ? min.x : max.x, planes[i].y >= 0.0f ? min.y : max.y, planes[i].z >= 0.0f ? min.z : max.z);
+				if ((planes[i].x * inner.x) + (planes[i].y * inner.y) + (planes[i].z * inner.z) + planes[i].w < 0.0f)
+				{
+					intersected |= (1 << i);
+				}
+			}
+			planeMask = intersected;
+			return true;
+		}
+
+		/*
+			Batch tests for structure of arrays data, visibility receives one bit per object (bit i % 32 of word i / 32) and needs to hold (count + 31) / 32 words
+			The optional planeMasks enable plane coherency for hierarchical tests: on input, bit n of an object's mask selects plane n for testing,
+			on output it holds the planes the (visible) object intersects, so its children only need to test these (and are fully visible for a mask of zero)
+			Returns the number of visible objects
+		*/
+		size_t checkSpheres(const float* x, const float* y, const float* z, const float* radius, size_t count, uint32_t* visibility, uint8_t* planeMasks = nullptr) const
+		{
+			std::fill(visibility, visibility + (count + 31) / 32, 0u);
+			const size_t simdCount = count - count % frustumlanes::Simd::width;
+			return checkSpheres<frustumlanes::Simd>(x, y, z, radius, 0, simdCount, visibility, planeMasks) +
+				checkSpheres<frustumlanes::Scalar>(x, y, z, radius, simdCount, count, visibility, planeMasks);
+		}
+
+		size_t checkBoxes(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ, size_t count, uint32_t* visibility, uint8_t* planeMasks = nullptr) const
+		{
+			std::fill(visibility, visibility + (count + 31) / 32, 0u);
+			const size_t simdCount = count - count % frustumlanes::Simd::width;
+			const float* boxMin[3] = { minX, minY, minZ };
+			const float* boxMax[3] = { maxX, maxY, maxZ };
+			return checkBoxes<frustumlanes::Simd>(boxMin, boxMax, 0, simdCount, visibility, planeMasks) +
+				checkBoxes<frustumlanes::Scalar>(boxMin, boxMax, simdCount, count, visibility, planeMasks);
+		}
+
+	private:
+		template <typename L>
+		size_t checkSpheres(const float* x, const float* y, const float* z, const float* radius, size_t begin, size_t end, uint32_t* visibility, uint8_t* planeMasks) const
+		{
+			size_t visibleCount = 0;
+			uint32_t outside[6];
+			uint32_t intersect[6];
+			for (size_t i = begin; i < end; i += L::width)
+			{
+				typename L::type px = L::load(x + i);
+				typename L::type py = L::load(y + i);
+				typename L::type pz = L::load(z + i);
+				typename L::type r = L::load(radius + i);
+				typename L::type nr = L::negate(r);
+				for (size_t p = 0; p < planes.size(); p++)
+				{
+					typename L::type d = L::madd(L::set(planes[p].x), px, L::madd(L::set(planes[p].y), py, L::madd(L::set(planes[p].z), pz, L::set(planes[p].w))));
+					outside[p] = L::lessEqual(d, nr);
+					intersect[p] = L::lessThan(d, r);
+				}
+				visibleCount += resolve(outside, intersect, i, L::width, visibility, planeMasks);
+			}
+			return visibleCount;
+		}
+
+		template <typename L>
+		size_t checkBoxes(const float* boxMin[3], const float* boxMax[3], size_t begin, size_t end, uint32_t* visibility, uint8_t* planeMasks) const
+		{
+			size_t visibleCount = 0;
+			uint32_t outside[6];
+			uint32_t intersect[6];
+			for (size_t i = begin; i < end; i += L::width)
+			{
+				for (size_t p = 0; p < planes.size(); p++)
+				{
+					// The corner furthest along the plane normal decides if the box is outside, the nearest one if it intersects
+					typename L::type outer[3], inner[3];
+					for (int c = 0; c < 3; c++)
+					{
+						outer[c] = L::load((planes[p][c] >= 0.0f ? boxMax[c] : boxMin[c]) + i);
+						inner[c] = L::load((planes[p][c] >= 0.0f ? boxMin[c] : boxMax[c]) + i);
+					}
+					typename L::type w = L::set(planes[p].w);
+					typename L::type dOuter = L::madd(L::set(planes[p].x), outer[0], L::madd(L::set(planes[p].y), outer[1], L::madd(L::set(planes[p].z), outer[2], w)));
+					typename L::type dInner = L::madd(L::set(planes[p].x), inner[0], L::madd(L::set(planes[p].y), inner[1], L::madd(L::set(planes[p].z), inner[2], w)));
+					outside[p] = L::lessThan(dOuter, L::set(0.0f));
+					intersect[p] = L::lessThan(dInner, L::set(0.0f));
+				}
+				visibleCount += resolve(outside, intersect, i, L::width, visibility, planeMasks);
+			}
+			return visibleCount;
+		}
+
+		// Combines the per plane lane bits of the objects first..first + width - 1 into their visibility bits and plane masks
+		static size_t resolve(const uint32_t outside[6], const uint32_t intersect[6], size_t first, size_t width, uint32_t* visibility, uint8_t* planeMasks)
+		{
+			uint32_t visibleBits = 0;
+			if (!planeMasks)
+			{
+				uint32_t outsideBits = 0;
+				for (size_t p = 0; p < 6; p++)
+				{
+					outsideBits |= outside[p];
+				}
+				visibleBits = ~outsideBits & ((1u << width) - 1);
+			}
+			else
+			{
+				for (size_t j = 0; j < width; j++)
+				{
+					const uint8_t mask = planeMasks[first + j];
+					bool visible = true;
+					uint8_t intersected = 0;
+					for (size_t p = 0; p < 6; p++)
+					{
+						if (mask & (1 << p))
+						{
+							visible &= ((outside[p] >> j) & 1) == 0;
+							intersected |= ((intersect[p] >> j) & 1) << p;
+						}
+					}
+					planeMasks[first + j] = intersected;
+					visibleBits |= (visible ? 1u : 0u) << j;
+				}
+			}
+			// Batches never straddle a word, as the SIMD width divides 32
+			visibility[first / 32] |= visibleBits << (first % 32);
+			size_t visibleCount = 0;
+			for (; visibleBits; visibleBits &= visibleBits - 1)
+			{
+				visibleCount++;
+			}
+			return visibleCount;
+		}
 	};
 }
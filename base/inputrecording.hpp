@@ -0,0 +1,123 @@
+/*
+* Camera and input recording for reproducible benchmark runs
+*
+* Copyright (C) 2026 by the games106 contributors
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <glm/glm.hpp>
+
+namespace vks
+{
+	/*
+		Stores the per frame state that drives an example: camera position and rotation, the animation timer,
+		the frame time and the key presses handled before the frame. Replaying a recording feeds the recorded
+		values instead of the measured frame times, so every run renders the same sequence of frames.
+
+		Recordings are plain text, one "k <key>" line per key press followed by one line per frame:
+		"f <frameTimer> <timer> <paused> <position.xyz> <rotation.xyz>"
+	*/
+	class InputRecording
+	{
+	public:
+		struct Frame {
+			float frameTimer = 0.0f;
+			float timer = 0.0f;
+			bool paused = false;
+			glm::vec3 position = glm::vec3(0.0f);
+			glm::vec3 rotation = glm::vec3(0.0f);
+			std::vector<uint32_t> keys;
+		};
+
+		std::vector<Frame> frames;
+
+		bool isRecording() const { return recording; }
+		bool isReplaying() const { return !frames.empty(); }
+
+		bool startRecording(const std::string& filename)
+		{
+			file.open(filename, std::ios::out);
+			if (!file.is_open()) {
+				return false;
+			}
+			file << "# vks input recording" << "\n";
+			file << std::setprecision(std::numeric_limits<float>::max_digits10);
+			recording = true;
+			return true;
+		}
+
+		void recordKey(uint32_t key)
+		{
+			if (recording) {
+				file << "k " << key << "\n";
+			}
+		}
+
+		void recordFrame(const glm::vec3& position, const glm::vec3& rotation, float timer, float frameTimer, bool paused)
+		{
+			if (recording) {
+				file << "f " << frameTimer << " " << timer << " " << (paused ? 1 : 0) << " "
+					<< position.x << " " << position.y << " " << position.z << " "
+					<< rotation.x << " " << rotation.y << " " << rotation.z << "\n";
+			}
+		}
+
+		bool load(const std::string& filename)
+		{
+			std::ifstream input(filename);
+			if (!input.is_open()) {
+				return false;
+			}
+			frames.clear();
+			Frame frame;
+			std::string line;
+			while (std::getline(input, line)) {
+				std::istringstream values(line);
+				std::string type;
+				values >> type;
+				if (type == "k") {
+					uint32_t key;
+					values >> key;
+					frame.keys.push_back(key);
+				} else if (type == "f") {
+					int paused = 0;
+					values >> frame.frameTimer >> frame.timer >> paused
+						>> frame.position.x >> frame.position.y >> frame.position.z
+						>> frame.rotation.x >> frame.rotation.y >> frame.rotation.z;
+					frame.paused = (paused != 0);
+					frames.push_back(frame);
+					frame = Frame();
+				}
+			}
+			current = 0;
+			return !frames.empty();
+		}
+
+		// Returns the next recorded frame, starting over at the end of the recording
+		const Frame& nextFrame()
+		{
+			const Frame& frame = frames[current];
+			current = (current + 1) % frames.size();
+			return frame;
+		}
+
+		void restart()
+		{
+			current = 0;
+		}
+
+	private:
+		std::ofstream file;
+		bool recording = false;
+		size_t current = 0;
+	};
+}
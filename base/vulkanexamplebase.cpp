@@ -8,6 +8,11 @@
 
 #include "vulkanexamplebase.h"
 
+#if defined(VK_EXAMPLE_GIT_REVISION_HEADER)
+// Generated at build time by the git_revision target, only this file is rebuilt when the revision changes
+#include "gitrevision.h"
+#endif
+
 #if (defined(VK_USE_PLATFORM_MACOS_MVK) && defined(VK_EXAMPLE_XCODE_GENERATED))
 #include <Cocoa/Cocoa.h>
 #include <QuartzCore/CAMetalLayer.h>
@@ -192,15 +197,101 @@ std::string VulkanExampleBase::getHomeworkShadersPath() const
 	return getAssetPath() + "homework/shaders/" + shaderDir + "/";
 }
 
+// Name of the executable without path and extension, falls back to the example name
+std::string VulkanExampleBase::getExecutableName() const
+{
+	std::string baseName = name;
+	if (!args.empty() && args[0] != nullptr) {
+		baseName = args[0];
+		size_t pos = baseName.find_last_of("/\\");
+		if (pos != std::string::npos) {
+			baseName = baseName.substr(pos + 1);
+		}
+		pos = baseName.find_last_of('.');
+		if (pos != std::string::npos) {
+			baseName = baseName.substr(0, pos);
+		}
+	}
+	return baseName;
+}
+
+std::string VulkanExampleBase::getPipelineCacheFileName() const
+{
+	// Use the executable name so each example gets its own cache file
+	return getExecutableName() + ".pipelinecache";
+}
+
 void VulkanExampleBase::createPipelineCache()
 {
+	std::vector<char> cacheData;
+	benchmark.pipelineCacheWarm = false;
+	if (settings.persistentPipelineCache) {
+		std::ifstream is(getPipelineCacheFileName(), std::ios::binary | std::ios::ate);
+		if (is.is_open()) {
+			cacheData.resize(static_cast<size_t>(is.tellg()));
+			is.seekg(0, std::ios::beg);
+			is.read(cacheData.data(), cacheData.size());
+			is.close();
+		}
+	}
+
+	// Only pass data to the driver that was written by the same device (and driver build, identified by the cache UUID)
+	if (!cacheData.empty()) {
+		VkPipelineCacheHeaderVersionOne header;
+		bool valid = cacheData.size() >= sizeof(header);
+		if (valid) {
+			memcpy(&header, cacheData.data(), sizeof(header));
+			valid = (header.headerSize >= sizeof(header)) && (header.headerSize <= cacheData.size()) &&
+				(header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE) &&
+				(header.vendorID == deviceProperties.vendorID) &&
+				(header.deviceID == deviceProperties.deviceID) &&
+				(memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0);
+		}
+		if (!valid) {
+			std::cout << "Discarding stale pipeline cache \"" << getPipelineCacheFileName() << "\"\n";
+			cacheData.clear();
+		}
+	}
+
 	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
 	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-	VK_CHECK_RESULT(vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &pipelineCache));
+	pipelineCacheCreateInfo.initialDataSize = cacheData.size();
+	pipelineCacheCreateInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+	VkResult result = vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &pipelineCache);
+	if ((result != VK_SUCCESS) && !cacheData.empty()) {
+		// Implementations may still reject data that passed header validation, fall back to an empty cache
+		pipelineCacheCreateInfo.initialDataSize = 0;
+		pipelineCacheCreateInfo.pInitialData = nullptr;
+		cacheData.clear();
+		result = vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &pipelineCache);
+	}
+	VK_CHECK_RESULT(result);
+	benchmark.pipelineCacheWarm = !cacheData.empty();
+}
+
+void VulkanExampleBase::savePipelineCache()
+{
+	if (!settings.persistentPipelineCache || (pipelineCache == VK_NULL_HANDLE)) {
+		return;
+	}
+	size_t dataSize = 0;
+	if ((vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS) || (dataSize == 0)) {
+		return;
+	}
+	std::vector<char> cacheData(dataSize);
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS) {
+		return;
+	}
+	std::ofstream os(getPipelineCacheFileName(), std::ios::binary | std::ios::trunc);
+	if (os.is_open()) {
+		os.write(cacheData.data(), dataSize);
+	}
 }
 
 void VulkanExampleBase::prepare()
 {
+	vks::CpuProfiler::Zone zone("VulkanExampleBase::prepare");
+	tPrepareStart = std::chrono::high_resolution_clock::now();
 	if (vulkanDevice->enableDebugMarkers) {
 		vks::debugmarker::setup(device);
 	}
@@ -217,6 +308,7 @@ void VulkanExampleBase::prepare()
 	if (settings.overlay) {
 		UIOverlay.device = vulkanDevice;
 		UIOverlay.queue = queue;
+		UIOverlay.frameCount = settings.framesInFlight;
 		UIOverlay.shaders = {
 			loadShader(getShadersPath() + "base/uioverlay.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
 			loadShader(getShadersPath() + "base/uioverlay.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
@@ -245,13 +337,22 @@ VkPipelineShaderStageCreateInfo VulkanExampleBase::loadShader(std::string fileNa
 void VulkanExampleBase::nextFrame()
 {
 	auto tStart = std::chrono::high_resolution_clock::now();
+	// A replayed frame replaces the state that was measured after the previous frame
+	if (inputRecording.isReplaying()) {
+		applyRecordedFrame(inputRecording.nextFrame());
+	} else {
+		inputRecording.recordFrame(camera.position, camera.rotation, timer, frameTimer, paused);
+	}
 	if (viewUpdated)
 	{
 		viewUpdated = false;
 		viewChanged();
 	}
 
-	render();
+	{
+		vks::CpuProfiler::Zone zone("frame");
+		render();
+	}
 	frameCounter++;
 	auto tEnd = std::chrono::high_resolution_clock::now();
 #if (defined(VK_USE_PLATFORM_IOS_MVK) || (defined(VK_USE_PLATFORM_MACOS_MVK) && !defined(VK_EXAMPLE_XCODE_GENERATED)))
@@ -300,8 +401,16 @@ void VulkanExampleBase::renderLoop()
 //     - for macOS, handle benchmarking within NSApp rendering loop via displayLinkOutputCb()
 #if !(defined(VK_USE_PLATFORM_IOS_MVK) || defined(VK_USE_PLATFORM_MACOS_MVK))
 	if (benchmark.active) {
-		benchmark.run([=] { render(); }, vulkanDevice->properties);
+		// Time spent preparing (incl. pipeline creation), the first frame is added by the benchmark itself
+		benchmark.startupTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tPrepareStart).count();
+		// A replayed recording is measured exactly once, unless a frame count is given
+		if (inputRecording.isReplaying() && (benchmark.outputFrames == -1)) {
+			benchmark.outputFrames = static_cast<int>(inputRecording.frames.size());
+			benchmark.duration = std::numeric_limits<uint32_t>::max() / 1000;
+		}
+		benchmark.run([=] { renderBenchmarkFrame(); }, vulkanDevice->properties);
 		vkDeviceWaitIdle(device);
+		finishBenchmark();
 		if (benchmark.filename != "") {
 			benchmark.saveResults();
 		}
@@ -664,11 +773,68 @@ void VulkanExampleBase::renderLoop()
 	}
 }
 
+void VulkanExampleBase::renderBenchmarkFrame()
+{
+	// Frames are only counted once the warmup phase is over, so GPU timings of the warmup are discarded
+	if (benchmark.frameCount == 0) {
+		gpuProfiler.resetStatistics();
+	}
+	if (inputRecording.isReplaying()) {
+		// The measured phase always starts at the beginning of the recording
+		if (benchmark.measuring && (benchmark.frameCount == 0)) {
+			inputRecording.restart();
+		}
+		applyRecordedFrame(inputRecording.nextFrame());
+		if (viewUpdated) {
+			viewUpdated = false;
+			viewChanged();
+		}
+	}
+	vks::CpuProfiler::Zone zone("frame");
+	render();
+}
+
+void VulkanExampleBase::applyRecordedFrame(const vks::InputRecording::Frame& frame)
+{
+	for (uint32_t key : frame.keys) {
+		keyPressed(key);
+	}
+	frameTimer = frame.frameTimer;
+	timer = frame.timer;
+	paused = frame.paused;
+	if ((camera.position != frame.position) || (camera.rotation != frame.rotation)) {
+		camera.setPosition(frame.position);
+		camera.setRotation(frame.rotation);
+		viewUpdated = true;
+	}
+}
+
+// Adds GPU pass times and the run description to the benchmark results and compares them against the baseline (if set)
+void VulkanExampleBase::finishBenchmark()
+{
+	benchmark.passTimes.clear();
+	for (auto& result : gpuProfiler.results) {
+		benchmark.passTimes.push_back(std::make_pair(result.name, result.averageMs()));
+	}
+	benchmark.printPassTimes();
+	benchmark.width = width;
+	benchmark.height = height;
+	benchmark.exampleName = getExecutableName();
+#if defined(VK_EXAMPLE_GIT_REVISION)
+	benchmark.gitRevision = VK_EXAMPLE_GIT_REVISION;
+#endif
+	if (benchmark.baselineFilename != "") {
+		benchmark.compareWithBaseline();
+	}
+}
+
 void VulkanExampleBase::updateOverlay()
 {
 	if (!settings.overlay)
 		return;
 
+	vks::CpuProfiler::Zone zone("updateOverlay");
+
 	ImGuiIO& io = ImGui::GetIO();
 
 	io.DisplaySize = ImVec2((float)width, (float)height);
@@ -688,6 +854,9 @@ void VulkanExampleBase::updateOverlay()
 	ImGui::TextUnformatted(title.c_str());
 	ImGui::TextUnformatted(deviceProperties.deviceName);
 	ImGui::Text("%.2f ms/frame (%.1d fps)", (1000.0f / lastFPS), lastFPS);
+	for (auto& result : gpuProfiler.results) {
+		ImGui::Text("%*s%s: %.3f ms (gpu)", static_cast<int>(result.depth * 2), "", result.name.c_str(), result.ms);
+	}
 
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
 	ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0.0f, 5.0f * UIOverlay.scale));
@@ -703,7 +872,18 @@ void VulkanExampleBase::updateOverlay()
 	ImGui::PopStyleVar();
 	ImGui::Render();
 
-	if (UIOverlay.update() || UIOverlay.updated) {
+	if (settings.framesInFlight > 1) {
+		if (UIOverlay.updated) {
+			// Command buffers are rebuilt below if a widget changed, which must not happen while older frames still use them
+			waitFramesInFlight();
+		} else {
+			// The overlay buffers of the next frame are only free once the previous submission of that frame has finished
+			VK_CHECK_RESULT(vkWaitForFences(device, 1, &frameFences[currentFrame], VK_TRUE, UINT64_MAX));
+		}
+	}
+	// Examples with more than one frame in flight record their command buffers per frame, which picks up the current frame's overlay buffers (see drawUI)
+	if (UIOverlay.update(currentFrame) || UIOverlay.updated) {
+		vks::CpuProfiler::Zone zone("buildCommandBuffers");
 		buildCommandBuffers();
 		UIOverlay.updated = false;
 	}
@@ -723,12 +903,16 @@ void VulkanExampleBase::drawUI(const VkCommandBuffer commandBuffer)
 		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-		UIOverlay.draw(commandBuffer);
+		UIOverlay.draw(commandBuffer, currentFrame);
 	}
 }
 
 void VulkanExampleBase::prepareFrame()
 {
+	// Wait until the GPU has finished the work previously submitted for this frame slot, so its semaphores (and any per-frame resources) can be reused
+	VK_CHECK_RESULT(vkWaitForFences(device, 1, &frameFences[currentFrame], VK_TRUE, UINT64_MAX));
+	// submitInfo points at semaphores, so swapping in the current frame's pair keeps existing submissions working
+	semaphores = frameSemaphores[currentFrame];
 	// Acquire the next image from the swap chain
 	VkResult result = swapChain.acquireNextImage(semaphores.presentComplete, &currentBuffer);
 	// Recreate the swapchain if it's no longer compatible with the surface (OUT_OF_DATE)
@@ -736,16 +920,28 @@ void VulkanExampleBase::prepareFrame()
 	if ((result == VK_ERROR_OUT_OF_DATE_KHR) || (result == VK_SUBOPTIMAL_KHR)) {
 		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 			windowResize();
+			return;
 		}
-		return;
 	}
 	else {
 		VK_CHECK_RESULT(result);
 	}
+	// Command buffers are built per swap chain image, so the image may still be in use by an older frame if images are acquired out of order
+	if ((imageFences[currentBuffer] != VK_NULL_HANDLE) && (imageFences[currentBuffer] != frameFences[currentFrame])) {
+		VK_CHECK_RESULT(vkWaitForFences(device, 1, &imageFences[currentBuffer], VK_TRUE, UINT64_MAX));
+	}
+	imageFences[currentBuffer] = frameFences[currentFrame];
+	// The command buffer of this image has finished, so its timestamps are available without waiting
+	gpuProfiler.collect(currentBuffer);
 }
 
 void VulkanExampleBase::submitFrame()
 {
+	// Examples submit their command buffers without a fence, so signal the frame fence with an empty submission that completes after all prior work on the queue
+	VK_CHECK_RESULT(vkResetFences(device, 1, &frameFences[currentFrame]));
+	VK_CHECK_RESULT(vkQueueSubmit(queue, 0, nullptr, frameFences[currentFrame]));
+	currentFrame = (currentFrame + 1) % settings.framesInFlight;
+
 	VkResult result = swapChain.queuePresent(queue, currentBuffer, semaphores.renderComplete);
 	// Recreate the swapchain if it's no longer compatible with the surface (OUT_OF_DATE) or no longer optimal for presentation (SUBOPTIMAL)
 	if ((result == VK_ERROR_OUT_OF_DATE_KHR) || (result == VK_SUBOPTIMAL_KHR)) {
@@ -757,7 +953,17 @@ void VulkanExampleBase::submitFrame()
 	else {
 		VK_CHECK_RESULT(result);
 	}
-	VK_CHECK_RESULT(vkQueueWaitIdle(queue));
+	// With a single frame in flight, keep the CPU and GPU in lockstep (examples rely on this to update shared resources after submission)
+	if (settings.framesInFlight == 1) {
+		VK_CHECK_RESULT(vkQueueWaitIdle(queue));
+	}
+}
+
+void VulkanExampleBase::waitFramesInFlight()
+{
+	if (!frameFences.empty()) {
+		VK_CHECK_RESULT(vkWaitForFences(device, static_cast<uint32_t>(frameFences.size()), frameFences.data(), VK_TRUE, UINT64_MAX));
+	}
 }
 
 VulkanExampleBase::VulkanExampleBase(bool enableValidation)
@@ -792,9 +998,16 @@ VulkanExampleBase::VulkanExampleBase(bool enableValidation)
 	commandLineParser.add("benchmark", { "-b", "--benchmark" }, 0, "Run example in benchmark mode");
 	commandLineParser.add("benchmarkwarmup", { "-bw", "--benchwarmup" }, 1, "Set warmup time for benchmark mode in seconds");
 	commandLineParser.add("benchmarkruntime", { "-br", "--benchruntime" }, 1, "Set duration time for benchmark mode in seconds");
-	commandLineParser.add("benchmarkresultfile", { "-bf", "--benchfilename" }, 1, "Set file name for benchmark results");
+	commandLineParser.add("benchmarkresultfile", { "-bf", "--benchfilename" }, 1, "Set file name for benchmark results (CSV, or a JSON report if the name ends with .json)");
 	commandLineParser.add("benchmarkresultframes", { "-bt", "--benchframetimes" }, 0, "Save frame times to benchmark results file");
 	commandLineParser.add("benchmarkframes", { "-bfs", "--benchmarkframes" }, 1, "Only render the given number of frames");
+	commandLineParser.add("benchmarkbaseline", { "--bench-baseline" }, 1, "Compare benchmark results against a JSON report of an earlier run (see --benchfilename)");
+	commandLineParser.add("benchmarkthreshold", { "--bench-threshold" }, 1, "Percentage a metric may be slower than the baseline before it is reported as a regression (default 5)");
+	commandLineParser.add("record", { "--record" }, 1, "Record camera, timer and key input of each frame to the given file");
+	commandLineParser.add("replay", { "--replay" }, 1, "Replay camera, timer and key input from a file written with --record (e.g. for benchmarks)");
+	commandLineParser.add("framesinflight", { "-fif", "--frames-in-flight" }, 1, "Set the number of frames the CPU may record ahead of the GPU (default 1, limited to 1 for examples without per frame resources)");
+	commandLineParser.add("trace", { "--trace" }, 1, "Record CPU profiler zones and write them to the given file (Chrome trace format)");
+	commandLineParser.add("nopipelinecache", { "-npc", "--no-pipeline-cache" }, 0, "Do not load or store the pipeline cache file (forces a cold start)");
 
 	commandLineParser.parse(args);
 	if (commandLineParser.isSet("help")) {
@@ -848,6 +1061,35 @@ VulkanExampleBase::VulkanExampleBase(bool enableValidation)
 	if (commandLineParser.isSet("benchmarkframes")) {
 		benchmark.outputFrames = commandLineParser.getValueAsInt("benchmarkframes", benchmark.outputFrames);
 	}
+	if (commandLineParser.isSet("benchmarkbaseline")) {
+		benchmark.baselineFilename = commandLineParser.getValueAsString("benchmarkbaseline", benchmark.baselineFilename);
+	}
+	if (commandLineParser.isSet("benchmarkthreshold")) {
+		benchmark.regressionThreshold = commandLineParser.getValueAsFloat("benchmarkthreshold", static_cast<float>(benchmark.regressionThreshold));
+	}
+	if (commandLineParser.isSet("nopipelinecache")) {
+		settings.persistentPipelineCache = false;
+	}
+	if (commandLineParser.isSet("framesinflight")) {
+		settings.framesInFlight = std::max(commandLineParser.getValueAsInt("framesinflight", settings.framesInFlight), 1);
+	}
+	if (commandLineParser.isSet("replay")) {
+		const std::string replayFilename = commandLineParser.getValueAsString("replay", "");
+		if (!inputRecording.load(replayFilename)) {
+			std::cerr << "Could not load input recording " << replayFilename << "\n";
+		}
+	}
+	else if (commandLineParser.isSet("record")) {
+		const std::string recordFilename = commandLineParser.getValueAsString("record", "");
+		if (!inputRecording.startRecording(recordFilename)) {
+			std::cerr << "Could not create input recording " << recordFilename << "\n";
+		}
+	}
+	if (commandLineParser.isSet("trace")) {
+		traceFilename = commandLineParser.getValueAsString("trace", "trace.json");
+		vks::CpuProfiler::enable();
+		vks::CpuProfiler::setThreadName("main");
+	}
 
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
 	// Vulkan library is loaded dynamically on Android
@@ -873,6 +1115,14 @@ VulkanExampleBase::VulkanExampleBase(bool enableValidation)
 
 VulkanExampleBase::~VulkanExampleBase()
 {
+	// Derived examples have been destroyed at this point, so all of their threads have stopped recording zones
+	if (!traceFilename.empty()) {
+		if (vks::CpuProfiler::writeTrace(traceFilename)) {
+			std::cout << "CPU trace written to " << traceFilename << "\n";
+		} else {
+			std::cerr << "Could not write CPU trace to " << traceFilename << "\n";
+		}
+	}
 	// Clean up Vulkan resources
 	swapChain.cleanup();
 	if (descriptorPool != VK_NULL_HANDLE)
@@ -897,16 +1147,24 @@ VulkanExampleBase::~VulkanExampleBase()
 	vkDestroyImage(device, depthStencil.image, nullptr);
 	vkFreeMemory(device, depthStencil.mem, nullptr);
 
+	savePipelineCache();
 	vkDestroyPipelineCache(device, pipelineCache, nullptr);
 
 	vkDestroyCommandPool(device, cmdPool, nullptr);
 
-	vkDestroySemaphore(device, semaphores.presentComplete, nullptr);
-	vkDestroySemaphore(device, semaphores.renderComplete, nullptr);
+	for (auto& frameSemaphore : frameSemaphores) {
+		vkDestroySemaphore(device, frameSemaphore.presentComplete, nullptr);
+		vkDestroySemaphore(device, frameSemaphore.renderComplete, nullptr);
+	}
+	for (auto& fence : frameFences) {
+		vkDestroyFence(device, fence, nullptr);
+	}
 	for (auto& fence : waitFences) {
 		vkDestroyFence(device, fence, nullptr);
 	}
 
+	gpuProfiler.destroy();
+
 	if (settings.overlay) {
 		UIOverlay.freeResources();
 	}
@@ -959,6 +1217,12 @@ bool VulkanExampleBase::initVulkan()
 {
 	VkResult err;
 
+	// Examples that update a single copy of e.g. their uniform buffers while rendering rely on the GPU having finished the previous frame
+	if ((settings.framesInFlight > 1) && !settings.multipleFramesInFlight) {
+		std::cout << "This example does not support more than one frame in flight, ignoring --frames-in-flight" << "\n";
+		settings.framesInFlight = 1;
+	}
+
 	// Vulkan instance
 	err = createInstance(settings.validation);
 	if (err) {
@@ -1054,17 +1318,25 @@ bool VulkanExampleBase::initVulkan()
 
 	swapChain.connect(instance, physicalDevice, device);
 
-	// Create synchronization objects
+	// Create synchronization objects, one set per frame in flight
 	VkSemaphoreCreateInfo semaphoreCreateInfo = vks::initializers::semaphoreCreateInfo();
-	// Create a semaphore used to synchronize image presentation
-	// Ensures that the image is displayed before we start submitting new commands to the queue
-	VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &semaphores.presentComplete));
-	// Create a semaphore used to synchronize command submission
-	// Ensures that the image is not presented until all commands have been submitted and executed
-	VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &semaphores.renderComplete));
+	// Frame fences are created signaled so the first wait for each frame slot returns immediately
+	VkFenceCreateInfo fenceCreateInfo = vks::initializers::fenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
+	frameSemaphores.resize(settings.framesInFlight);
+	frameFences.resize(settings.framesInFlight);
+	for (uint32_t i = 0; i < settings.framesInFlight; i++) {
+		// Create a semaphore used to synchronize image presentation
+		// Ensures that the image is displayed before we start submitting new commands to the queue
+		VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &frameSemaphores[i].presentComplete));
+		// Create a semaphore used to synchronize command submission
+		// Ensures that the image is not presented until all commands have been submitted and executed
+		VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &frameSemaphores[i].renderComplete));
+		VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &frameFences[i]));
+	}
+	semaphores = frameSemaphores[0];
 
 	// Set up submit info structure
-	// Semaphores will stay the same during application lifetime
+	// The semaphores member is updated with the current frame's pair in prepareFrame()
 	// Command buffer submission info is set by each example
 	submitInfo = vks::initializers::submitInfo();
 	submitInfo.pWaitDstStageMask = &submitPipelineStages;
@@ -1269,7 +1541,7 @@ void VulkanExampleBase::handleMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPAR
 			}
 		}
 
-		keyPressed((uint32_t)wParam);
+		handleKeyPress((uint32_t)wParam);
 		break;
 	case WM_KEYUP:
 		if (camera.type == Camera::firstperson)
@@ -1405,7 +1677,7 @@ int32_t VulkanExampleBase::handleAppInput(struct android_app* app, AInputEvent*
 							float x = AMotionEvent_getX(event, 0) - vulkanExample->touchPos.x;
 							float y = AMotionEvent_getY(event, 0) - vulkanExample->touchPos.y;
 							if ((x * x + y * y) < deadZone) {
-								vulkanExample->keyPressed(TOUCH_DOUBLE_TAP);
+								vulkanExample->handleKeyPress(TOUCH_DOUBLE_TAP);
 								vulkanExample->touchDown = false;
 							}
 						}
@@ -1463,16 +1735,16 @@ int32_t VulkanExampleBase::handleAppInput(struct android_app* app, AInputEvent*
 		switch (keyCode)
 		{
 		case AKEYCODE_BUTTON_A:
-			vulkanExample->keyPressed(GAMEPAD_BUTTON_A);
+			vulkanExample->handleKeyPress(GAMEPAD_BUTTON_A);
 			break;
 		case AKEYCODE_BUTTON_B:
-			vulkanExample->keyPressed(GAMEPAD_BUTTON_B);
+			vulkanExample->handleKeyPress(GAMEPAD_BUTTON_B);
 			break;
 		case AKEYCODE_BUTTON_X:
-			vulkanExample->keyPressed(GAMEPAD_BUTTON_X);
+			vulkanExample->handleKeyPress(GAMEPAD_BUTTON_X);
 			break;
 		case AKEYCODE_BUTTON_Y:
-			vulkanExample->keyPressed(GAMEPAD_BUTTON_Y);
+			vulkanExample->handleKeyPress(GAMEPAD_BUTTON_Y);
 			break;
 		case AKEYCODE_1:							// support keyboards with no function keys
 		case AKEYCODE_F1:
@@ -1481,14 +1753,14 @@ int32_t VulkanExampleBase::handleAppInput(struct android_app* app, AInputEvent*
 			vulkanExample->UIOverlay.updated = true;
 			break;
 		case AKEYCODE_BUTTON_R1:
-			vulkanExample->keyPressed(GAMEPAD_BUTTON_R1);
+			vulkanExample->handleKeyPress(GAMEPAD_BUTTON_R1);
 			break;
 		case AKEYCODE_P:
 		case AKEYCODE_BUTTON_START:
 			vulkanExample->paused = !vulkanExample->paused;
 			break;
 		default:
-			vulkanExample->keyPressed(keyCode);		// handle example-specific key press events
+			vulkanExample->handleKeyPress(keyCode);		// handle example-specific key press events
 			break;
 		};
 
@@ -1689,7 +1961,7 @@ static CVReturn displayLinkOutputCallback(CVDisplayLinkRef displayLink, const CV
 			vulkanExample->camera.keys.right = true;
 			break;
 		default:
-			vulkanExample->keyPressed(event.keyCode);	// handle example-specific key press events
+			vulkanExample->handleKeyPress(event.keyCode);	// handle example-specific key press events
 			break;
 	}
 }
@@ -1871,7 +2143,9 @@ void VulkanExampleBase::displayLinkOutputCb()
 {
 #if defined(VK_EXAMPLE_XCODE_GENERATED)
 	if (benchmark.active) {
-		benchmark.run([=] { render(); }, vulkanDevice->properties);
+		benchmark.run([=] { renderBenchmarkFrame(); }, vulkanDevice->properties);
+		vkDeviceWaitIdle(device);
+		finishBenchmark();
 		if (benchmark.filename != "") {
 			benchmark.saveResults();
 		}
@@ -2087,7 +2361,7 @@ void VulkanExampleBase::handleEvent(const DFBWindowEvent *event)
 			default:
 				break;
 		}
-		keyPressed(event->key_symbol);
+		handleKeyPress(event->key_symbol);
 		break;
 	case DWET_SIZE:
 		destWidth = event->w;
@@ -2244,7 +2518,7 @@ void VulkanExampleBase::keyboardKey(struct wl_keyboard *keyboard,
 	}
 
 	if (state)
-		keyPressed(key);
+		handleKeyPress(key);
 }
 
 /*static*/void VulkanExampleBase::keyboardModifiersCb(void *data,
@@ -2623,7 +2897,7 @@ void VulkanExampleBase::handleEvent(const xcb_generic_event_t *event)
 				quit = true;
 				break;
 		}
-		keyPressed(keyEvent->detail);
+		handleKeyPress(keyEvent->detail);
 	}
 	break;
 	case XCB_DESTROY_NOTIFY:
@@ -2657,6 +2931,24 @@ void VulkanExampleBase::viewChanged() {}
 
 void VulkanExampleBase::keyPressed(uint32_t) {}
 
+void VulkanExampleBase::handleKeyPress(uint32_t key)
+{
+	// Replays only use recorded input, so runs stay identical
+	if (inputRecording.isReplaying()) {
+		return;
+	}
+	inputRecording.recordKey(key);
+	keyPressed(key);
+}
+
+uint32_t VulkanExampleBase::getRandomSeed() const
+{
+	if (benchmark.active || inputRecording.isRecording() || inputRecording.isReplaying()) {
+		return 0;
+	}
+	return static_cast<uint32_t>(time(nullptr));
+}
+
 void VulkanExampleBase::mouseMoved(double x, double y, bool & handled) {}
 
 void VulkanExampleBase::buildCommandBuffers() {}
@@ -2669,6 +2961,8 @@ void VulkanExampleBase::createSynchronizationPrimitives()
 	for (auto& fence : waitFences) {
 		VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &fence));
 	}
+	// No swap chain image is in use by a frame yet
+	imageFences.assign(drawCmdBuffers.size(), VK_NULL_HANDLE);
 }
 
 void VulkanExampleBase::createCommandPool()
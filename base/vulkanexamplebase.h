@@ -72,6 +72,9 @@
 #include "VulkanInitializers.hpp"
 #include "camera.hpp"
 #include "benchmark.hpp"
+#include "VulkanGpuProfiler.h"
+#include "cpuprofiler.hpp"
+#include "inputrecording.hpp"
 
 class VulkanExampleBase
 {
@@ -84,7 +87,13 @@ private:
 	void handleMouseMove(int32_t x, int32_t y);
 	void nextFrame();
 	void updateOverlay();
+	void renderBenchmarkFrame();
+	void finishBenchmark();
+	void applyRecordedFrame(const vks::InputRecording::Frame& frame);
 	void createPipelineCache();
+	void savePipelineCache();
+	std::string getExecutableName() const;
+	std::string getPipelineCacheFileName() const;
 	void createCommandPool();
 	void createSynchronizationPrimitives();
 	void initSwapchain();
@@ -101,6 +110,8 @@ protected:
 	uint32_t frameCounter = 0;
 	uint32_t lastFPS = 0;
 	std::chrono::time_point<std::chrono::high_resolution_clock> lastTimestamp, tPrevEnd;
+	// Start of the preparation phase, used to measure the time to the first frame
+	std::chrono::time_point<std::chrono::high_resolution_clock> tPrepareStart;
 	// Vulkan instance, stores all per-application states
 	VkInstance instance;
 	std::vector<std::string> supportedInstanceExtensions;
@@ -144,17 +155,25 @@ protected:
 	// List of shader modules created (stored for cleanup)
 	std::vector<VkShaderModule> shaderModules;
 	// Pipeline cache object
-	VkPipelineCache pipelineCache;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
 	// Wraps the swap chain to present images (framebuffers) to the windowing system
 	VulkanSwapChain swapChain;
 	// Synchronization semaphores
-	struct {
+	struct Semaphores {
 		// Swap chain image presentation
 		VkSemaphore presentComplete;
 		// Command buffer submission and execution
 		VkSemaphore renderComplete;
 	} semaphores;
 	std::vector<VkFence> waitFences;
+	// Index of the frame currently being recorded (0...settings.framesInFlight-1)
+	uint32_t currentFrame = 0;
+	// Per-frame semaphores, the active pair is copied to semaphores in prepareFrame() so submitInfo stays valid
+	std::vector<Semaphores> frameSemaphores;
+	// Per-frame fences, signaled once all work submitted for that frame has finished executing
+	std::vector<VkFence> frameFences;
+	// Frame fence that last used a given swap chain image (VK_NULL_HANDLE if not in flight)
+	std::vector<VkFence> imageFences;
 public:
 	bool prepared = false;
 	bool resized = false;
@@ -169,6 +188,12 @@ public:
 	float frameTimer = 1.0f;
 
 	vks::Benchmark benchmark;
+	/** @brief Per pass GPU timings, examples create it and record scopes into their command buffers, results are collected in prepareFrame and shown in the UI overlay */
+	vks::GpuProfiler gpuProfiler;
+	/** @brief File the CPU profiler zones are written to at exit (Chrome trace format), set with --trace */
+	std::string traceFilename;
+	/** @brief Per frame camera, timer and key input, recorded with --record and replayed with --replay */
+	vks::InputRecording inputRecording;
 
 	/** @brief Encapsulated physical and logical vulkan device */
 	vks::VulkanDevice *vulkanDevice;
@@ -183,6 +208,12 @@ public:
 		bool vsync = false;
 		/** @brief Enable UI overlay */
 		bool overlay = true;
+		/** @brief Number of frames the CPU may record ahead of the GPU (1 = wait for the queue to become idle after each frame) */
+		uint32_t framesInFlight = 1;
+		/** @brief Set by examples that keep per frame copies of all resources they update while rendering and record their command buffers per frame (indexed by currentFrame), all others are limited to one frame in flight */
+		bool multipleFramesInFlight = false;
+		/** @brief Load the pipeline cache from disk at startup and store it at shutdown */
+		bool persistentPipelineCache = true;
 	} settings;
 
 	VkClearColorValue defaultClearColor = { { 0.025f, 0.025f, 0.025f, 1.0f } };
@@ -354,6 +385,10 @@ public:
 	virtual void viewChanged();
 	/** @brief (Virtual) Called after a key was pressed, can be used to do custom key handling */
 	virtual void keyPressed(uint32_t);
+	/** @brief Forwards a key press to keyPressed, records it if input recording is active (ignored while replaying) */
+	void handleKeyPress(uint32_t key);
+	/** @brief Seed for random scene setup, fixed when benchmarking, recording or replaying so runs are comparable */
+	uint32_t getRandomSeed() const;
 	/** @brief (Virtual) Called after the mouse cursor moved and before internal events (like camera rotation) is handled */
 	virtual void mouseMoved(double x, double y, bool &handled);
 	/** @brief (Virtual) Called when the window has been resized, can be used by the sample application to recreate resources */
@@ -387,6 +422,8 @@ public:
 	void prepareFrame();
 	/** @brief Presents the current image to the swap chain */
 	void submitFrame();
+	/** @brief Waits until all frames in flight have finished executing, call before touching resources shared between frames (e.g. rebuilding command buffers) */
+	void waitFramesInFlight();
 	/** @brief (Virtual) Default image acquire + submission and command buffer submission function */
 	virtual void renderFrame();
 
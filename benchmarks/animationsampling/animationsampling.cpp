@@ -0,0 +1,111 @@
+/*
+* Benchmark: glTF animation sampling
+*
+* Evaluates vkglTF::Animation::update for many channels with long clips, both for regular playback
+* and for random seeks, and compares it against a linear scan over all keyframe intervals
+*
+* Copyright (C) 2026 by the games106 contributors
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <vector>
+#include <random>
+#include <memory>
+
+#include "VulkanglTFModel.h"
+#include "microbenchmark.hpp"
+
+const uint32_t channelCount = 256;
+const float frameTime = 1.0f / 60.0f;
+const uint32_t framesPerMeasurement = 60;
+
+// Builds an animation with one translation, rotation and scale channel per node, each sampler with keyCount keys at 30 keys per second
+void createAnimation(vkglTF::Animation& animation, std::vector<std::unique_ptr<vkglTF::Node>>& nodes, uint32_t keyCount)
+{
+	std::default_random_engine rndEngine(keyCount);
+	std::uniform_real_distribution<float> rndDist(-1.0f, 1.0f);
+	const vkglTF::AnimationChannel::PathType paths[3] = { vkglTF::AnimationChannel::PathType::TRANSLATION, vkglTF::AnimationChannel::PathType::ROTATION, vkglTF::AnimationChannel::PathType::SCALE };
+	for (uint32_t c = 0; c < channelCount; c++) {
+		if (c % 3 == 0) {
+			nodes.emplace_back(new vkglTF::Node{});
+		}
+		vkglTF::AnimationSampler sampler{};
+		sampler.interpolation = vkglTF::AnimationSampler::InterpolationType::LINEAR;
+		sampler.inputs.resize(keyCount);
+		sampler.outputsVec4.resize(keyCount);
+		for (uint32_t k = 0; k < keyCount; k++) {
+			sampler.inputs[k] = (float)k / 30.0f;
+			sampler.outputsVec4[k] = glm::vec4(rndDist(rndEngine), rndDist(rndEngine), rndDist(rndEngine), rndDist(rndEngine));
+		}
+		animation.samplers.push_back(sampler);
+		vkglTF::AnimationChannel channel{};
+		channel.path = paths[c % 3];
+		channel.node = nodes.back().get();
+		channel.samplerIndex = c;
+		animation.channels.push_back(channel);
+	}
+	animation.start = 0.0f;
+	animation.end = (float)(keyCount - 1) / 30.0f;
+}
+
+// Reference: scans all intervals of every sampler, as updateAnimation did before using keyframe cursors
+void updateLinear(vkglTF::Animation& animation, float time)
+{
+	for (auto& channel : animation.channels) {
+		vkglTF::AnimationSampler& sampler = animation.samplers[channel.samplerIndex];
+		for (size_t i = 0; i < sampler.inputs.size() - 1; i++) {
+			if ((time >= sampler.inputs[i]) && (time <= sampler.inputs[i + 1])) {
+				float u = std::max(0.0f, time - sampler.inputs[i]) / (sampler.inputs[i + 1] - sampler.inputs[i]);
+				channel.node->translation = glm::vec3(glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u));
+			}
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::cout << "Animation sampling, " << channelCount << " channels, " << framesPerMeasurement << " frames per measurement" << std::endl;
+	const uint32_t keyCounts[] = { 100, 1000, 10000 };
+	for (uint32_t keyCount : keyCounts) {
+		vkglTF::Animation animation;
+		std::vector<std::unique_ptr<vkglTF::Node>> nodes;
+		createAnimation(animation, nodes, keyCount);
+		const std::string suffix = " (" + std::to_string(keyCount) + " keys)";
+
+		// Regular playback advances by one frame per update, wrapping around at the end of the clip
+		float time = 0.0f;
+		double ms = vks::microbenchmark::measure([&]() {
+			for (uint32_t f = 0; f < framesPerMeasurement; f++) {
+				time += frameTime;
+				if (time > animation.end) {
+					time -= animation.end;
+				}
+				vks::microbenchmark::doNotOptimize(animation.update(time));
+			}
+		});
+		vks::microbenchmark::report("playback, cursor" + suffix, ms / framesPerMeasurement);
+
+		// Random seeks can't use the cursor and fall back to the binary search
+		std::default_random_engine rndEngine(keyCount);
+		std::uniform_real_distribution<float> rndTime(animation.start, animation.end);
+		ms = vks::microbenchmark::measure([&]() {
+			for (uint32_t f = 0; f < framesPerMeasurement; f++) {
+				vks::microbenchmark::doNotOptimize(animation.update(rndTime(rndEngine)));
+			}
+		});
+		vks::microbenchmark::report("random seeks, binary search" + suffix, ms / framesPerMeasurement);
+
+		ms = vks::microbenchmark::measure([&]() {
+			for (uint32_t f = 0; f < framesPerMeasurement; f++) {
+				time += frameTime;
+				if (time > animation.end) {
+					time -= animation.end;
+				}
+				updateLinear(animation, time);
+			}
+		});
+		vks::microbenchmark::report("playback, linear scan" + suffix, ms / framesPerMeasurement);
+	}
+	return 0;
+}
@@ -0,0 +1,275 @@
+/*
+* Benchmark suite runner
+*
+* Runs a list of examples and homework apps one after another in benchmark mode with the same warmup, runtime and resolution,
+* then aggregates their JSON reports into a single table and suite report (see the benchsuite target in benchmarks/CMakeLists.txt)
+*
+* Usage: benchsuiterunner [options] app [app ...]
+*   --bindir <dir>          Directory containing the app executables (defaults to the directory of this executable)
+*   --outdir <dir>          Directory for the per app reports and benchsuite.json (defaults to the current directory)
+*   -bw, --benchwarmup <s>  Warmup time in seconds (default 1)
+*   -br, --benchruntime <s> Measured time in seconds (default 10)
+*   -w, --width <px>        Window width (default 1280)
+*   -h, --height <px>       Window height (default 720)
+*   --bench-baseline <dir>  Compare each app against <dir>/<app>.json of an earlier suite run
+*
+* Copyright (C) 2026 by the games106 contributors
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#endif
+
+#include "vulkan/vulkan.h"
+#include "benchmark.hpp"
+
+struct AppResult
+{
+	std::string name;
+	// Exit code of the app, the report is only read if the app exited normally
+	int exitCode = 0;
+	bool reportFound = false;
+	std::string device;
+	double fps = 0.0;
+	double startupMs = 0.0;
+	std::map<std::string, double> metrics;
+	std::map<std::string, double> passes;
+	uint32_t regressions = 0;
+};
+
+std::string readFile(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open()) {
+		return "";
+	}
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	return buffer.str();
+}
+
+// Reads a top level value of the JSON reports written by vks::Benchmark, strings are returned without quotes
+std::string readJsonValue(const std::string& json, const std::string& key)
+{
+	size_t pos = json.find("\"" + key + "\"");
+	if (pos == std::string::npos) {
+		return "";
+	}
+	pos = json.find_first_not_of(" \t", json.find(':', pos) + 1);
+	if (json[pos] == '"') {
+		return json.substr(pos + 1, json.find('"', pos + 1) - pos - 1);
+	}
+	return json.substr(pos, json.find_first_of(",\n}", pos) - pos);
+}
+
+// Number of string entries of a top level array
+uint32_t countJsonArray(const std::string& json, const std::string& key)
+{
+	const size_t pos = json.find("\"" + key + "\"");
+	if (pos == std::string::npos) {
+		return 0;
+	}
+	const size_t begin = json.find('[', pos);
+	const size_t end = json.find(']', begin);
+	if ((begin == std::string::npos) || (end == std::string::npos)) {
+		return 0;
+	}
+	uint32_t quotes = 0;
+	for (size_t i = begin; i < end; i++) {
+		quotes += (json[i] == '"') ? 1 : 0;
+	}
+	return quotes / 2;
+}
+
+std::string quote(const std::string& value)
+{
+	return "\"" + value + "\"";
+}
+
+int main(int argc, char* argv[])
+{
+	std::string binDir;
+	std::string outDir = ".";
+	std::string baselineDir;
+	uint32_t warmup = 1;
+	uint32_t runtime = 10;
+	uint32_t width = 1280;
+	uint32_t height = 720;
+	std::vector<std::string> apps;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		const bool hasValue = (i + 1 < argc);
+		if ((arg == "--bindir") && hasValue) {
+			binDir = argv[++i];
+		} else if ((arg == "--outdir") && hasValue) {
+			outDir = argv[++i];
+		} else if (((arg == "-bw") || (arg == "--benchwarmup")) && hasValue) {
+			warmup = std::atoi(argv[++i]);
+		} else if (((arg == "-br") || (arg == "--benchruntime")) && hasValue) {
+			runtime = std::atoi(argv[++i]);
+		} else if (((arg == "-w") || (arg == "--width")) && hasValue) {
+			width = std::atoi(argv[++i]);
+		} else if (((arg == "-h") || (arg == "--height")) && hasValue) {
+			height = std::atoi(argv[++i]);
+		} else if ((arg == "--bench-baseline") && hasValue) {
+			baselineDir = argv[++i];
+		} else if ((arg.size() > 0) && (arg[0] == '-')) {
+			std::cerr << "Unknown or incomplete argument " << arg << "\n";
+			return EXIT_FAILURE;
+		} else {
+			apps.push_back(arg);
+		}
+	}
+
+	if (apps.empty()) {
+		std::cerr << "Usage: benchsuiterunner [--bindir dir] [--outdir dir] [-bw s] [-br s] [-w px] [-h px] [--bench-baseline dir] app [app ...]\n";
+		return EXIT_FAILURE;
+	}
+
+	if (binDir.empty()) {
+		binDir = argv[0];
+		const size_t separator = binDir.find_last_of("/\\");
+		binDir = (separator != std::string::npos) ? binDir.substr(0, separator) : ".";
+	}
+
+#if defined(_WIN32)
+	const std::string executableSuffix = ".exe";
+#else
+	const std::string executableSuffix = "";
+#endif
+
+	// Apps are run one after another, so they don't compete for the GPU and each one starts with a cold process
+	std::vector<AppResult> results;
+	for (auto& app : apps) {
+		AppResult result;
+		result.name = app;
+		const std::string reportFilename = outDir + "/" + app + ".json";
+		std::remove(reportFilename.c_str());
+
+		std::stringstream command;
+		command << quote(binDir + "/" + app + executableSuffix) << " -b"
+			<< " -bw " << warmup << " -br " << runtime
+			<< " -w " << width << " -h " << height
+			<< " -bf " << quote(reportFilename);
+		if (!baselineDir.empty()) {
+			const std::string baselineFilename = baselineDir + "/" + app + ".json";
+			if (std::ifstream(baselineFilename).good()) {
+				command << " --bench-baseline " << quote(baselineFilename);
+			}
+		}
+		std::cout << "Running " << app << "\n" << std::flush;
+#if defined(_WIN32)
+		// cmd.exe strips the outer quotes of a command that starts with a quoted path
+		result.exitCode = std::system(quote(command.str()).c_str());
+#else
+		const int status = std::system(command.str().c_str());
+		result.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+
+		const std::string json = readFile(reportFilename);
+		if ((result.exitCode == 0) && vks::Benchmark::readJsonNumbers(json, "metrics", result.metrics)) {
+			result.reportFound = true;
+			result.device = readJsonValue(json, "device");
+			result.fps = std::atof(readJsonValue(json, "fps").c_str());
+			result.startupMs = std::atof(readJsonValue(json, "startup_ms").c_str());
+			vks::Benchmark::readJsonNumbers(json, "passes", result.passes);
+			result.regressions = countJsonArray(json, "regressions");
+		}
+		results.push_back(result);
+	}
+
+	// Summary table
+	const char* columns[] = { "mean_ms", "p50_ms", "p90_ms", "p99_ms" };
+	std::cout << "\n" << std::left << std::setw(24) << "app" << std::right << std::setw(10) << "fps";
+	for (auto column : columns) {
+		std::cout << std::setw(10) << column;
+	}
+	std::cout << std::setw(12) << "startup_ms" << "  status" << "\n";
+	std::cout << std::fixed << std::setprecision(3);
+	uint32_t failed = 0;
+	uint32_t regressed = 0;
+	for (auto& result : results) {
+		std::cout << std::left << std::setw(24) << result.name << std::right;
+		if (!result.reportFound) {
+			std::cout << "  failed (exit code " << result.exitCode << ")" << "\n";
+			failed++;
+			continue;
+		}
+		std::cout << std::setw(10) << result.fps;
+		for (auto column : columns) {
+			std::cout << std::setw(10) << result.metrics[column];
+		}
+		std::cout << std::setw(12) << result.startupMs << "  ";
+		if (result.regressions > 0) {
+			std::cout << result.regressions << " regression(s)";
+			regressed++;
+		} else {
+			std::cout << "ok";
+		}
+		std::cout << "\n";
+	}
+
+	// Suite report
+	const std::string suiteFilename = outDir + "/benchsuite.json";
+	std::ofstream suite(suiteFilename, std::ios::out);
+	if (!suite.is_open()) {
+		std::cerr << "Could not write " << suiteFilename << "\n";
+		return EXIT_FAILURE;
+	}
+	suite << std::fixed << std::setprecision(4);
+	suite << "{\n";
+	suite << "  \"warmup_s\": " << warmup << ",\n";
+	suite << "  \"runtime_s\": " << runtime << ",\n";
+	suite << "  \"width\": " << width << ",\n";
+	suite << "  \"height\": " << height << ",\n";
+	suite << "  \"apps\": [";
+	for (size_t i = 0; i < results.size(); i++) {
+		const AppResult& result = results[i];
+		suite << (i > 0 ? "," : "") << "\n    {\n";
+		suite << "      \"name\": \"" << vks::Benchmark::escapeJson(result.name) << "\",\n";
+		suite << "      \"status\": \"" << (result.reportFound ? "ok" : "failed") << "\",\n";
+		suite << "      \"exitcode\": " << result.exitCode << ",\n";
+		suite << "      \"report\": \"" << vks::Benchmark::escapeJson(result.name + ".json") << "\"";
+		if (result.reportFound) {
+			suite << ",\n      \"device\": \"" << result.device << "\",\n";
+			suite << "      \"fps\": " << result.fps << ",\n";
+			suite << "      \"startup_ms\": " << result.startupMs << ",\n";
+			suite << "      \"regressions\": " << result.regressions << ",\n";
+			suite << "      \"metrics\": {";
+			bool first = true;
+			for (auto& metric : result.metrics) {
+				suite << (first ? "" : ",") << "\n        \"" << metric.first << "\": " << metric.second;
+				first = false;
+			}
+			suite << "\n      },\n";
+			suite << "      \"passes\": {";
+			first = true;
+			for (auto& pass : result.passes) {
+				suite << (first ? "" : ",") << "\n        \"" << vks::Benchmark::escapeJson(pass.first) << "\": " << pass.second;
+				first = false;
+			}
+			suite << (result.passes.empty() ? "}" : "\n      }");
+		}
+		suite << "\n    }";
+	}
+	suite << "\n  ]\n}\n";
+	std::cout << "\n" << "Suite report written to " << suiteFilename << "\n";
+
+	if (failed > 0) {
+		std::cerr << failed << " of " << results.size() << " apps failed\n";
+	}
+	return ((failed > 0) || (regressed > 0)) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/*
+* Benchmark: view frustum culling
+*
+* Culls one million spheres and boxes with the per object tests of vks::Frustum and with the batch tests,
+* and hierarchically with plane masks for objects grouped under common bounds
+*
+* Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <vector>
+#include <random>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "frustum.hpp"
+#include "microbenchmark.hpp"
+
+const uint32_t objectCount = 1000000;
+// Objects are placed in clusters, which are the parents for the hierarchical test
+const uint32_t clusterSize = 64;
+const uint32_t clusterCount = objectCount / clusterSize;
+
+// Structure of arrays layout expected by the batch tests
+struct Objects {
+	std::vector<float> x, y, z, radius;
+	std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+	void resize(size_t count)
+	{
+		for (auto array : { &x, &y, &z, &radius, &minX, &minY, &minZ, &maxX, &maxY, &maxZ }) {
+			array->resize(count);
+		}
+	}
+	void setBox(size_t index, glm::vec3 min, glm::vec3 max)
+	{
+		minX[index] = min.x; minY[index] = min.y; minZ[index] = min.z;
+		maxX[index] = max.x; maxY[index] = max.y; maxZ[index] = max.z;
+		const glm::vec3 center = (min + max) * 0.5f;
+		x[index] = center.x; y[index] = center.y; z[index] = center.z;
+		radius[index] = glm::length(max - center);
+	}
+};
+
+void createObjects(Objects& objects, Objects& clusters)
+{
+	std::default_random_engine rndEngine(objectCount);
+	std::uniform_real_distribution<float> rndPosition(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> rndOffset(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> rndSize(0.1f, 1.0f);
+	objects.resize(objectCount);
+	clusters.resize(clusterCount);
+	for (uint32_t c = 0; c < clusterCount; c++) {
+		const glm::vec3 clusterCenter(rndPosition(rndEngine), rndPosition(rndEngine) * 0.1f, rndPosition(rndEngine));
+		glm::vec3 clusterMin(FLT_MAX), clusterMax(-FLT_MAX);
+		for (uint32_t i = c * clusterSize; i < (c + 1) * clusterSize; i++) {
+			const glm::vec3 center = clusterCenter + glm::vec3(rndOffset(rndEngine), rndOffset(rndEngine), rndOffset(rndEngine));
+			const glm::vec3 extent(rndSize(rndEngine), rndSize(rndEngine), rndSize(rndEngine));
+			objects.setBox(i, center - extent, center + extent);
+			clusterMin = glm::min(clusterMin, center - extent);
+			clusterMax = glm::max(clusterMax, center + extent);
+		}
+		clusters.setBox(c, clusterMin, clusterMax);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Objects objects, clusters;
+	createObjects(objects, clusters);
+
+	vks::Frustum frustum;
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 20.0f, -400.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	frustum.update(projection * view);
+
+	std::vector<uint32_t> visibility((objectCount + 31) / 32);
+	size_t visibleCount = 0;
+#if defined(VKS_FRUSTUM_AVX2)
+	const std::string isa = "AVX2";
+#elif defined(VKS_FRUSTUM_SSE2)
+	const std::string isa = "SSE2";
+#else
+	const std::string isa = "scalar";
+#endif
+	std::cout << "Frustum culling, " << objectCount << " objects, batch tests use " << isa << std::endl;
+
+	double ms = vks::microbenchmark::measure([&]() {
+		visibleCount = 0;
+		for (uint32_t i = 0; i < objectCount; i++) {
+			visibleCount += frustum.checkSphere(glm::vec3(objects.x[i], objects.y[i], objects.z[i]), objects.radius[i]) ? 1 : 0;
+		}
+	});
+	vks::microbenchmark::report("spheres, checkSphere (" + std::to_string(visibleCount) + " visible)", ms);
+
+	ms = vks::microbenchmark::measure([&]() {
+		visibleCount = frustum.checkSpheres(objects.x.data(), objects.y.data(), objects.z.data(), objects.radius.data(), objectCount, visibility.data());
+	});
+	vks::microbenchmark::report("spheres, checkSpheres (" + std::to_string(visibleCount) + " visible)", ms);
+
+	ms = vks::microbenchmark::measure([&]() {
+		visibleCount = 0;
+		for (uint32_t i = 0; i < objectCount; i++) {
+			visibleCount += frustum.checkBox(glm::vec3(objects.minX[i], objects.minY[i], objects.minZ[i]), glm::vec3(objects.maxX[i], objects.maxY[i], objects.maxZ[i])) ? 1 : 0;
+		}
+	});
+	vks::microbenchmark::report("boxes, checkBox (" + std::to_string(visibleCount) + " visible)", ms);
+
+	ms = vks::microbenchmark::measure([&]() {
+		visibleCount = frustum.checkBoxes(objects.minX.data(), objects.minY.data(), objects.minZ.data(), objects.maxX.data(), objects.maxY.data(), objects.maxZ.data(), objectCount, visibility.data());
+	});
+	vks::microbenchmark::report("boxes, checkBoxes (" + std::to_string(visibleCount) + " visible)", ms);
+
+	// Clusters are tested first, objects of visible clusters only test the planes their cluster intersects
+	std::vector<uint32_t> clusterVisibility((clusterCount + 31) / 32);
+	std::vector<uint8_t> clusterMasks(clusterCount);
+	std::vector<uint8_t> planeMasks(clusterSize);
+	std::vector<uint32_t> objectVisibility(clusterSize / 32);
+	ms = vks::microbenchmark::measure([&]() {
+		visibleCount = 0;
+		std::fill(clusterMasks.begin(), clusterMasks.end(), static_cast<uint8_t>(vks::Frustum::ALL_PLANES));
+		frustum.checkBoxes(clusters.minX.data(), clusters.minY.data(), clusters.minZ.data(), clusters.maxX.data(), clusters.maxY.data(), clusters.maxZ.data(), clusterCount, clusterVisibility.data(), clusterMasks.data());
+		for (uint32_t c = 0; c < clusterCount; c++) {
+			if (((clusterVisibility[c / 32] >> (c % 32)) & 1) == 0) {
+				continue;
+			}
+			if (clusterMasks[c] == 0) {
+				visibleCount += clusterSize;
+				continue;
+			}
+			const size_t first = c * clusterSize;
+			std::fill(planeMasks.begin(), planeMasks.end(), clusterMasks[c]);
+			visibleCount += frustum.checkBoxes(&objects.minX[first], &objects.minY[first], &objects.minZ[first], &objects.maxX[first], &objects.maxY[first], &objects.maxZ[first], clusterSize, objectVisibility.data(), planeMasks.data());
+		}
+	});
+	vks::microbenchmark::report("boxes, hierarchical with plane masks (" + std::to_string(visibleCount) + " visible)", ms);
+	return 0;
+}
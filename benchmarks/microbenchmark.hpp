@@ -0,0 +1,58 @@
+/*
+* Minimal timing helpers for the CPU micro benchmarks
+*
+* Copyright (C) 2026 by the games106 contributors
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <functional>
+
+namespace vks
+{
+	namespace microbenchmark
+	{
+		// Keeps the compiler from removing computations whose results are otherwise unused
+		template <typename T>
+		inline void doNotOptimize(const T& value)
+		{
+#if defined(_MSC_VER)
+			// MSVC has no inline assembly on x64, a store through a volatile pointer keeps the value alive instead
+			const void* volatile sink = &value;
+			(void)sink;
+#else
+			asm volatile("" : : "r,m"(value) : "memory");
+#endif
+		}
+
+		/*
+			Calls func until at least minTime milliseconds have passed (after a short warm up) and returns the average time per call in milliseconds
+		*/
+		inline double measure(std::function<void()> func, double minTime = 250.0)
+		{
+			for (uint32_t i = 0; i < 3; i++) {
+				func();
+			}
+			uint64_t calls = 0;
+			double elapsed = 0.0;
+			auto tStart = std::chrono::high_resolution_clock::now();
+			while (elapsed < minTime) {
+				func();
+				calls++;
+				elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+			}
+			return elapsed / (double)calls;
+		}
+
+		inline void report(const std::string& name, double milliseconds)
+		{
+			std::cout << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(4) << std::setw(12) << milliseconds << " ms" << std::endl;
+		}
+	}
+}
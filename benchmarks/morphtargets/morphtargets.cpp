@@ -0,0 +1,390 @@
+/*
+* Benchmark: Sparse morph target blending
+*
+* Blends a dense grid mesh with one morph target per bump (see vkglTF::FileLoadingFlags::MorphTargets) on the CPU and copies it into the vertex buffer before drawing it
+* By default a weights animation fades through the targets, so only one or two of them are active at any time and only their deltas are added
+* With --all-targets all targets stay active with changing weights, run both modes with --benchmark to compare frame times
+* The model is generated at startup, as the asset pack contains no model with morph targets of this size
+*
+* Copyright (C) 2026 by the games106 contributors
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <fstream>
+#include <sstream>
+
+#include "vulkanexamplebase.h"
+#include "VulkanglTFModel.h"
+
+#define ENABLE_VALIDATION false
+
+// Vertices along each side of the grid mesh
+#define GRID_SIZE 256
+// Bumps (one morph target each) along each side of the grid mesh
+#define TARGET_GRID_SIZE 4
+#define TARGET_COUNT (TARGET_GRID_SIZE * TARGET_GRID_SIZE)
+#define MESH_SIZE 4.0f
+#define BUMP_HEIGHT 0.4f
+// Time between two keyframes of the weights animation in seconds
+#define KEYFRAME_TIME 0.5f
+
+// Writes the generated model to the working directory (like the pipeline cache), the binary buffer is stored next to the glTF file
+class ModelWriter
+{
+private:
+	std::vector<uint8_t> data;
+	std::vector<std::string> bufferViews;
+	std::vector<std::string> accessors;
+public:
+	// Adds a float or uint32 accessor with its own buffer view, extra is appended to the accessor (e.g. min and max)
+	uint32_t addAccessor(const void* src, uint32_t count, const std::string& type, uint32_t componentCount, uint32_t componentType, const std::string& extra = "")
+	{
+		const size_t size = count * componentCount * 4;
+		std::stringstream bufferView;
+		bufferView << "{\"buffer\":0,\"byteOffset\":" << data.size() << ",\"byteLength\":" << size << "}";
+		bufferViews.push_back(bufferView.str());
+		data.insert(data.end(), static_cast<const uint8_t*>(src), static_cast<const uint8_t*>(src) + size);
+		std::stringstream accessor;
+		accessor << "{\"bufferView\":" << bufferViews.size() - 1 << ",\"componentType\":" << componentType << ",\"count\":" << count << ",\"type\":\"" << type << "\"" << extra << "}";
+		accessors.push_back(accessor.str());
+		return static_cast<uint32_t>(accessors.size() - 1);
+	}
+
+	void write(const std::string& filename, const std::string& binFilename, const std::string& content)
+	{
+		std::ofstream bin(binFilename, std::ios::binary);
+		bin.write(reinterpret_cast<const char*>(data.data()), data.size());
+		std::ofstream gltf(filename);
+		gltf << "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}]," << content;
+		gltf << ",\"buffers\":[{\"byteLength\":" << data.size() << ",\"uri\":\"" << binFilename << "\"}],\"bufferViews\":[";
+		for (size_t i = 0; i < bufferViews.size(); i++) {
+			gltf << (i > 0 ? "," : "") << bufferViews[i];
+		}
+		gltf << "],\"accessors\":[";
+		for (size_t i = 0; i < accessors.size(); i++) {
+			gltf << (i > 0 ? "," : "") << accessors[i];
+		}
+		gltf << "]}";
+	}
+};
+
+class VulkanExample : public VulkanExampleBase
+{
+public:
+	bool allTargets = false;
+	float animationTimer = 0.0f;
+
+	vkglTF::Model model;
+
+	// Uses the shaders of the computecloth sample
+	struct UniformData {
+		glm::mat4 projection;
+		glm::mat4 modelview;
+		glm::vec4 lightPos = glm::vec4(-2.0f, 4.0f, -2.0f, 1.0f);
+	} uniformData;
+	// One uniform buffer and descriptor set per frame in flight
+	std::vector<vks::Buffer> uniformBuffers;
+	std::vector<VkDescriptorSet> descriptorSets;
+
+	VkPipeline pipeline;
+	VkPipelineLayout pipelineLayout;
+	VkDescriptorSetLayout descriptorSetLayout;
+
+	VulkanExample() : VulkanExampleBase(ENABLE_VALIDATION)
+	{
+		allTargets = std::find(args.begin(), args.end(), std::string("--all-targets")) != args.end();
+		title = allTargets ? "Morph target benchmark (all targets active)" : "Morph target benchmark (sparse targets)";
+		camera.type = Camera::CameraType::lookat;
+		camera.setPerspective(60.0f, (float)width / (float)height, 0.1f, 256.0f);
+		camera.setRotation(glm::vec3(-40.0f, 0.0f, 0.0f));
+		camera.setTranslation(glm::vec3(0.0f, 0.0f, -5.0f));
+		// Blended vertices and uniform buffers are updated per frame in flight and the command buffer is recorded every frame
+		settings.multipleFramesInFlight = true;
+	}
+
+	~VulkanExample()
+	{
+		vkDestroyPipeline(device, pipeline, nullptr);
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+		for (auto& buffer : uniformBuffers) {
+			buffer.destroy();
+		}
+	}
+
+	/*
+		Generates a grid mesh with one morph target per bump, the targets only store the vertices inside their bump
+		The weights animation fades from one target to the next, so at most two targets are active at the same time
+	*/
+	void generateModel(const std::string& filename, const std::string& binFilename)
+	{
+		ModelWriter writer;
+		const uint32_t vertexCount = GRID_SIZE * GRID_SIZE;
+		std::vector<glm::vec3> positions(vertexCount);
+		std::vector<glm::vec3> normals(vertexCount, glm::vec3(0.0f, 1.0f, 0.0f));
+		for (uint32_t z = 0; z < GRID_SIZE; z++) {
+			for (uint32_t x = 0; x < GRID_SIZE; x++) {
+				positions[z * GRID_SIZE + x] = glm::vec3(static_cast<float>(x) / (GRID_SIZE - 1) - 0.5f, 0.0f, static_cast<float>(z) / (GRID_SIZE - 1) - 0.5f) * MESH_SIZE;
+			}
+		}
+		std::vector<uint32_t> indices;
+		for (uint32_t z = 0; z < GRID_SIZE - 1; z++) {
+			for (uint32_t x = 0; x < GRID_SIZE - 1; x++) {
+				const uint32_t i = z * GRID_SIZE + x;
+				indices.insert(indices.end(), { i, i + GRID_SIZE, i + 1, i + 1, i + GRID_SIZE, i + GRID_SIZE + 1 });
+			}
+		}
+		std::stringstream bounds;
+		bounds << ",\"min\":[" << -MESH_SIZE * 0.5f << ",0," << -MESH_SIZE * 0.5f << "],\"max\":[" << MESH_SIZE * 0.5f << ",0," << MESH_SIZE * 0.5f << "]";
+		const uint32_t positionAccessor = writer.addAccessor(positions.data(), vertexCount, "VEC3", 3, 5126, bounds.str());
+		const uint32_t normalAccessor = writer.addAccessor(normals.data(), vertexCount, "VEC3", 3, 5126);
+		const uint32_t indexAccessor = writer.addAccessor(indices.data(), static_cast<uint32_t>(indices.size()), "SCALAR", 1, 5125);
+
+		// Bumps with a smooth falloff, vertices outside of the radius have zero deltas and are not stored by the loader
+		const float cellSize = MESH_SIZE / TARGET_GRID_SIZE;
+		const float radius = cellSize * 0.75f;
+		std::stringstream targets;
+		for (uint32_t t = 0; t < TARGET_COUNT; t++) {
+			const glm::vec2 center = (glm::vec2(static_cast<float>(t % TARGET_GRID_SIZE), static_cast<float>(t / TARGET_GRID_SIZE)) + 0.5f) * cellSize - MESH_SIZE * 0.5f;
+			std::vector<glm::vec3> positionDeltas(vertexCount, glm::vec3(0.0f));
+			std::vector<glm::vec3> normalDeltas(vertexCount, glm::vec3(0.0f));
+			for (uint32_t v = 0; v < vertexCount; v++) {
+				const glm::vec2 d = glm::vec2(positions[v].x, positions[v].z) - center;
+				const float q = glm::dot(d, d) / (radius * radius);
+				if (q >= 1.0f) {
+					continue;
+				}
+				// height = BUMP_HEIGHT * (1 - q)^2
+				positionDeltas[v].y = BUMP_HEIGHT * (1.0f - q) * (1.0f - q);
+				const glm::vec2 slope = d * (-4.0f * BUMP_HEIGHT * (1.0f - q) / (radius * radius));
+				normalDeltas[v] = glm::normalize(glm::vec3(-slope.x, 1.0f, -slope.y)) - glm::vec3(0.0f, 1.0f, 0.0f);
+			}
+			const uint32_t positionDeltaAccessor = writer.addAccessor(positionDeltas.data(), vertexCount, "VEC3", 3, 5126);
+			const uint32_t normalDeltaAccessor = writer.addAccessor(normalDeltas.data(), vertexCount, "VEC3", 3, 5126);
+			targets << (t > 0 ? "," : "") << "{\"POSITION\":" << positionDeltaAccessor << ",\"NORMAL\":" << normalDeltaAccessor << "}";
+		}
+
+		// Keyframe k has target k fully active, the last keyframe equals the first one so the animation loops
+		std::vector<float> times(TARGET_COUNT + 1);
+		std::vector<float> weights((TARGET_COUNT + 1) * TARGET_COUNT, 0.0f);
+		for (uint32_t k = 0; k <= TARGET_COUNT; k++) {
+			times[k] = k * KEYFRAME_TIME;
+			weights[k * TARGET_COUNT + (k % TARGET_COUNT)] = 1.0f;
+		}
+		std::stringstream timeBounds;
+		timeBounds << ",\"min\":[0],\"max\":[" << times.back() << "]";
+		const uint32_t timeAccessor = writer.addAccessor(times.data(), static_cast<uint32_t>(times.size()), "SCALAR", 1, 5126, timeBounds.str());
+		const uint32_t weightAccessor = writer.addAccessor(weights.data(), static_cast<uint32_t>(weights.size()), "SCALAR", 1, 5126);
+
+		std::stringstream content;
+		content << "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":" << positionAccessor << ",\"NORMAL\":" << normalAccessor << "},\"indices\":" << indexAccessor;
+		content << ",\"targets\":[" << targets.str() << "]}]}]";
+		content << ",\"animations\":[{\"samplers\":[{\"input\":" << timeAccessor << ",\"output\":" << weightAccessor << ",\"interpolation\":\"LINEAR\"}]";
+		content << ",\"channels\":[{\"sampler\":0,\"target\":{\"node\":0,\"path\":\"weights\"}}]}]";
+		writer.write(filename, binFilename, content.str());
+	}
+
+	// Records the command buffer of the acquired swap chain image, using the staging and uniform buffers of the current frame
+	void buildCommandBuffer()
+	{
+		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+
+		VkClearValue clearValues[2];
+		clearValues[0].color = defaultClearColor;
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
+		renderPassBeginInfo.renderPass = renderPass;
+		renderPassBeginInfo.renderArea.offset.x = 0;
+		renderPassBeginInfo.renderArea.offset.y = 0;
+		renderPassBeginInfo.renderArea.extent.width = width;
+		renderPassBeginInfo.renderArea.extent.height = height;
+		renderPassBeginInfo.clearValueCount = 2;
+		renderPassBeginInfo.pClearValues = clearValues;
+		renderPassBeginInfo.framebuffer = frameBuffers[currentBuffer];
+
+		VkCommandBuffer commandBuffer = drawCmdBuffers[currentBuffer];
+		VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &cmdBufInfo));
+
+		gpuProfiler.beginFrame(commandBuffer, currentBuffer);
+
+		// Copy the blended vertices outside of the render pass
+		gpuProfiler.beginScope(commandBuffer, "morph targets");
+		model.recordMorphTargets(commandBuffer, currentFrame);
+		gpuProfiler.endScope(commandBuffer);
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport viewport = vks::initializers::viewport((float)width, (float)height, 0.0f, 1.0f);
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+		VkRect2D scissor = vks::initializers::rect2D(width, height, 0, 0);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		gpuProfiler.beginScope(commandBuffer, "scene");
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		model.draw(commandBuffer);
+		gpuProfiler.endScope(commandBuffer);
+
+		drawUI(commandBuffer);
+
+		vkCmdEndRenderPass(commandBuffer);
+
+		VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+	}
+
+	void loadAssets()
+	{
+		const std::string filename = "morphtargets_generated.gltf";
+		generateModel(filename, "morphtargets_generated.bin");
+		model.loadFromFile(filename, vulkanDevice, queue, vkglTF::FileLoadingFlags::MorphTargets | vkglTF::FileLoadingFlags::DontLoadImages);
+		model.prepareMorphTargets(settings.framesInFlight);
+	}
+
+	void setupDescriptors()
+	{
+		const uint32_t setCount = settings.framesInFlight;
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, setCount),
+		};
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, setCount);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
+
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
+		};
+		VkDescriptorSetLayoutCreateInfo descriptorLayoutInfo = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorLayoutInfo, nullptr, &descriptorSetLayout));
+
+		descriptorSets.resize(setCount);
+		for (uint32_t i = 0; i < setCount; i++) {
+			VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSets[i]));
+			VkWriteDescriptorSet writeDescriptorSet = vks::initializers::writeDescriptorSet(descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffers[i].descriptor);
+			vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+		}
+	}
+
+	void preparePipelines()
+	{
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo = vks::initializers::pipelineLayoutCreateInfo(&descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = vks::initializers::pipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+		// The grid is visible from both sides
+		VkPipelineRasterizationStateCreateInfo rasterizationState = vks::initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
+		VkPipelineColorBlendAttachmentState blendAttachmentState = vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE);
+		VkPipelineColorBlendStateCreateInfo colorBlendState = vks::initializers::pipelineColorBlendStateCreateInfo(1, &blendAttachmentState);
+		VkPipelineDepthStencilStateCreateInfo depthStencilState = vks::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+		VkPipelineViewportStateCreateInfo viewportState = vks::initializers::pipelineViewportStateCreateInfo(1, 1, 0);
+		VkPipelineMultisampleStateCreateInfo multisampleState = vks::initializers::pipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT, 0);
+		std::vector<VkDynamicState> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamicState = vks::initializers::pipelineDynamicStateCreateInfo(dynamicStateEnables);
+		std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {
+			loadShader(getShadersPath() + "computecloth/sphere.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
+			loadShader(getShadersPath() + "computecloth/sphere.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
+		};
+
+		VkGraphicsPipelineCreateInfo pipelineCI = vks::initializers::pipelineCreateInfo(pipelineLayout, renderPass, 0);
+		pipelineCI.pInputAssemblyState = &inputAssemblyState;
+		pipelineCI.pRasterizationState = &rasterizationState;
+		pipelineCI.pColorBlendState = &colorBlendState;
+		pipelineCI.pMultisampleState = &multisampleState;
+		pipelineCI.pViewportState = &viewportState;
+		pipelineCI.pDepthStencilState = &depthStencilState;
+		pipelineCI.pDynamicState = &dynamicState;
+		pipelineCI.stageCount = static_cast<uint32_t>(shaderStages.size());
+		pipelineCI.pStages = shaderStages.data();
+		pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState({ vkglTF::VertexComponent::Position, vkglTF::VertexComponent::UV, vkglTF::VertexComponent::Normal });
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipeline));
+	}
+
+	void prepareUniformBuffers()
+	{
+		uniformBuffers.resize(settings.framesInFlight);
+		for (auto& buffer : uniformBuffers) {
+			VK_CHECK_RESULT(vulkanDevice->createBuffer(
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&buffer,
+				sizeof(uniformData)));
+			VK_CHECK_RESULT(buffer.map());
+		}
+	}
+
+	void updateUniformBuffer(uint32_t index)
+	{
+		uniformData.projection = camera.matrices.perspective;
+		uniformData.modelview = camera.matrices.view;
+		memcpy(uniformBuffers[index].mapped, &uniformData, sizeof(uniformData));
+	}
+
+	// Advances the target weights, the vertices are blended per frame by uploadMorphTargets
+	void updateWeights()
+	{
+		if (allTargets) {
+			vkglTF::Mesh* mesh = model.linearNodes[0]->mesh;
+			for (size_t t = 0; t < mesh->weights.size(); t++) {
+				// Never reaches zero, so all targets stay active
+				mesh->weights[t] = 0.55f + 0.45f * sin(animationTimer * 2.0f + static_cast<float>(t));
+			}
+			model.updateMorphTargets();
+		} else {
+			model.updateAnimation(0, animationTimer);
+		}
+	}
+
+	void draw()
+	{
+		VulkanExampleBase::prepareFrame();
+		// The staging and uniform buffers of the current frame and the command buffer of the acquired image are no longer in use by the GPU once prepareFrame() returns
+		model.uploadMorphTargets(currentFrame);
+		updateUniformBuffer(currentFrame);
+		buildCommandBuffer();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
+		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
+		VulkanExampleBase::submitFrame();
+	}
+
+	void prepare()
+	{
+		VulkanExampleBase::prepare();
+		gpuProfiler.create(vulkanDevice, static_cast<uint32_t>(drawCmdBuffers.size()));
+		loadAssets();
+		prepareUniformBuffers();
+		setupDescriptors();
+		preparePipelines();
+		prepared = true;
+	}
+
+	virtual void render()
+	{
+		if (!prepared)
+			return;
+		if (!paused && !model.animations.empty()) {
+			animationTimer += frameTimer;
+			if (animationTimer > model.animations[0].end) {
+				animationTimer -= model.animations[0].end;
+			}
+			updateWeights();
+		}
+		draw();
+	}
+
+	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
+	{
+		if (overlay->header("Info")) {
+			uint32_t blendedDeltas = 0;
+			for (const auto& target : model.morphTargets.activeTargets) {
+				blendedDeltas += target.deltaCount;
+			}
+			overlay->text("Active targets: %d / %d", static_cast<int32_t>(model.morphTargets.activeTargets.size()), TARGET_COUNT);
+			overlay->text("Blended deltas: %d", blendedDeltas);
+		}
+	}
+};
+
+VULKAN_EXAMPLE_MAIN()
@@ -0,0 +1,90 @@
+/*
+* Benchmark: glTF node lookup at load time
+*
+* Builds the node hierarchy of a synthetic rig with 1000 joints and resolves the targets of 10000 animation channels
+* and the joints of its skin, like loadAnimations and loadSkins do, using the node index table of vkglTF::Model
+* and a recursive search over the hierarchy for comparison
+*
+* Copyright (C) 2026 by the games106 contributors
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <vector>
+#include <random>
+
+#include "VulkanglTFModel.h"
+#include "microbenchmark.hpp"
+
+const uint32_t jointCount = 1000;
+const uint32_t channelCount = 10000;
+
+// Node 0 is the armature, all other nodes are joints parented to one of the few joints before them
+void createRig(tinygltf::Model& gltfModel, std::vector<uint32_t>& channelTargets)
+{
+	std::default_random_engine rndEngine(jointCount);
+	gltfModel.nodes.resize(jointCount + 1);
+	gltfModel.nodes[0].name = "Armature";
+	gltfModel.nodes[0].children.push_back(1);
+	for (uint32_t i = 2; i <= jointCount; i++) {
+		uint32_t parent = i - 1 - std::uniform_int_distribution<uint32_t>(0, std::min(i - 2, 3u))(rndEngine);
+		gltfModel.nodes[parent].children.push_back(i);
+	}
+	for (uint32_t i = 1; i <= jointCount; i++) {
+		gltfModel.nodes[i].name = "Joint" + std::to_string(i);
+		gltfModel.nodes[i].translation = { 0.0, 0.1, 0.0 };
+	}
+	// Channels animate random joints, as exported rigs usually don't list them in hierarchy order
+	std::uniform_int_distribution<uint32_t> rndJoint(1, jointCount);
+	channelTargets.resize(channelCount);
+	for (auto& target : channelTargets) {
+		target = rndJoint(rndEngine);
+	}
+}
+
+// Reference: searches the hierarchy from every root, as nodeFromIndex did before using the node index table
+vkglTF::Node* findNodeRecursive(vkglTF::Model& model, uint32_t index)
+{
+	for (auto node : model.nodes) {
+		vkglTF::Node* nodeFound = model.findNode(node, index);
+		if (nodeFound) {
+			return nodeFound;
+		}
+	}
+	return nullptr;
+}
+
+// Loads the hierarchy into a new model and resolves all channel targets and skin joints with the given lookup
+template <typename Lookup>
+void load(const tinygltf::Model& gltfModel, const std::vector<uint32_t>& channelTargets, Lookup lookup)
+{
+	vkglTF::Model model;
+	std::vector<uint32_t> indexBuffer;
+	std::vector<vkglTF::Vertex> vertexBuffer;
+	model.loadNode(nullptr, gltfModel.nodes[0], 0, gltfModel, indexBuffer, vertexBuffer, 1.0f);
+	for (uint32_t target : channelTargets) {
+		vks::microbenchmark::doNotOptimize(lookup(model, target));
+	}
+	for (uint32_t joint = 1; joint <= jointCount; joint++) {
+		vks::microbenchmark::doNotOptimize(lookup(model, joint));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	tinygltf::Model gltfModel;
+	std::vector<uint32_t> channelTargets;
+	createRig(gltfModel, channelTargets);
+	std::cout << "Node lookup, " << jointCount << " joints, " << channelCount << " channels" << std::endl;
+
+	double ms = vks::microbenchmark::measure([&]() {
+		load(gltfModel, channelTargets, [](vkglTF::Model& model, uint32_t index) { return model.nodeFromIndex(index); });
+	});
+	vks::microbenchmark::report("load, node index table", ms);
+
+	ms = vks::microbenchmark::measure([&]() {
+		load(gltfModel, channelTargets, findNodeRecursive);
+	});
+	vks::microbenchmark::report("load, recursive search", ms);
+	return 0;
+}
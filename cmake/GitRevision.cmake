@@ -0,0 +1,18 @@
+# Writes the short hash of the checked out commit to OUTPUT_FILE as VK_EXAMPLE_GIT_REVISION
+# Run in script mode by the git_revision target, the file is left untouched if the revision didn't change
+execute_process(COMMAND ${GIT_EXECUTABLE} rev-parse --short HEAD
+	WORKING_DIRECTORY ${SOURCE_DIR}
+	OUTPUT_VARIABLE GIT_REVISION
+	OUTPUT_STRIP_TRAILING_WHITESPACE
+	ERROR_QUIET)
+IF(NOT GIT_REVISION)
+	set(GIT_REVISION "unknown")
+ENDIF()
+
+set(CONTENT "#define VK_EXAMPLE_GIT_REVISION \"${GIT_REVISION}\"\n")
+IF(EXISTS ${OUTPUT_FILE})
+	file(READ ${OUTPUT_FILE} CURRENT_CONTENT)
+ENDIF()
+IF(NOT "${CONTENT}" STREQUAL "${CURRENT_CONTENT}")
+	file(WRITE ${OUTPUT_FILE} "${CONTENT}")
+ENDIF()
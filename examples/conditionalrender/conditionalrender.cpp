@@ -90,7 +90,7 @@ public:
 				*/
 				vkCmdBeginConditionalRenderingEXT(commandBuffer, &conditionalRenderingBeginInfo);
 
-				vkCmdDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
+				vkCmdDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, primitive->vertexOffset, 0);
 
 				vkCmdEndConditionalRenderingEXT(commandBuffer);
 			}
@@ -137,7 +137,7 @@ public:
 
 			const VkDeviceSize offsets[1] = { 0 };
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], 0, 1, &scene.vertices.buffer, offsets);
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], scene.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(drawCmdBuffers[i], scene.indices.buffer, 0, scene.indices.type);
 			for (auto node : scene.nodes) {
 				renderNode(node, drawCmdBuffers[i]);
 			}
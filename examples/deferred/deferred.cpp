@@ -96,6 +96,9 @@ public:
 	VkSampler colorSampler;
 
 	VkCommandBuffer offScreenCmdBuffer = VK_NULL_HANDLE;
+	// Signaled when the last submission of the offscreen command buffer has finished, its timestamps are only read after that
+	VkFence offscreenFence = VK_NULL_HANDLE;
+	uint32_t gbufferProfilerSlot = 0;
 
 	// Semaphore used to synchronize between offscreen and final scene rendering
 	VkSemaphore offscreenSemaphore = VK_NULL_HANDLE;
@@ -161,6 +164,7 @@ public:
 		textures.floor.normalMap.destroy();
 
 		vkDestroySemaphore(device, offscreenSemaphore, nullptr);
+		vkDestroyFence(device, offscreenFence, nullptr);
 	}
 
 	// Enable physical device features required for this example
@@ -381,9 +385,12 @@ public:
 	// Build command buffer for rendering the scene to the offscreen frame buffer attachments
 	void buildDeferredCommandBuffer()
 	{
+		vks::CpuProfiler::Zone zone("buildDeferredCommandBuffer");
 		if (offScreenCmdBuffer == VK_NULL_HANDLE)
 		{
 			offScreenCmdBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, false);
+			VkFenceCreateInfo fenceCreateInfo = vks::initializers::fenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
+			VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &offscreenFence));
 		}
 
 		// Create a semaphore used to synchronize offscreen rendering and usage
@@ -409,6 +416,10 @@ public:
 
 		VK_CHECK_RESULT(vkBeginCommandBuffer(offScreenCmdBuffer, &cmdBufInfo));
 
+		// The offscreen command buffer uses the profiler slot after those of the per swap chain image command buffers
+		gpuProfiler.beginFrame(offScreenCmdBuffer, gbufferProfilerSlot);
+		gpuProfiler.beginScope(offScreenCmdBuffer, "gbuffer");
+
 		vkCmdBeginRenderPass(offScreenCmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 		VkViewport viewport = vks::initializers::viewport((float)offScreenFrameBuf.width, (float)offScreenFrameBuf.height, 0.0f, 1.0f);
@@ -430,6 +441,8 @@ public:
 
 		vkCmdEndRenderPass(offScreenCmdBuffer);
 
+		gpuProfiler.endScope(offScreenCmdBuffer);
+
 		VK_CHECK_RESULT(vkEndCommandBuffer(offScreenCmdBuffer));
 	}
 
@@ -446,6 +459,7 @@ public:
 
 	void buildCommandBuffers()
 	{
+		vks::CpuProfiler::Zone zone("buildCommandBuffers");
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
 
 		VkClearValue clearValues[2];
@@ -467,6 +481,8 @@ public:
 
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			gpuProfiler.beginFrame(drawCmdBuffers[i], i);
+
 			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 			VkViewport viewport = vks::initializers::viewport((float)width, (float)height, 0.0f, 1.0f);
@@ -480,7 +496,9 @@ public:
    			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.composition);
 			// Final composition as full screen quad
 			// Note: Also used for debug display if debugDisplayTarget > 0
+			gpuProfiler.beginScope(drawCmdBuffers[i], "composition");
 			vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
+			gpuProfiler.endScope(drawCmdBuffers[i]);
 
 			drawUI(drawCmdBuffers[i]);
 
@@ -683,6 +701,7 @@ public:
 	// Update matrices used for the offscreen rendering of the scene
 	void updateUniformBufferOffscreen()
 	{
+		vks::CpuProfiler::Zone zone("updateUniformBufferOffscreen");
 		uboOffscreenVS.projection = camera.matrices.perspective;
 		uboOffscreenVS.view = camera.matrices.view;
 		uboOffscreenVS.model = glm::mat4(1.0f);
@@ -692,6 +711,7 @@ public:
 	// Update lights and parameters passed to the composition shaders
 	void updateUniformBufferComposition()
 	{
+		vks::CpuProfiler::Zone zone("updateUniformBufferComposition");
 		// White
 		uboComposition.lights[0].position = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
 		uboComposition.lights[0].color = glm::vec3(1.5f);
@@ -744,6 +764,12 @@ public:
 	{
 		VulkanExampleBase::prepareFrame();
 
+		// The offscreen command buffer and its profiler slot are shared by all frames in flight, so wait for its previous submission
+		// before reading the timestamps and submitting it again
+		VK_CHECK_RESULT(vkWaitForFences(device, 1, &offscreenFence, VK_TRUE, UINT64_MAX));
+		gpuProfiler.collect(gbufferProfilerSlot);
+		VK_CHECK_RESULT(vkResetFences(device, 1, &offscreenFence));
+
 		// The scene render command buffer has to wait for the offscreen
 		// rendering to be finished before we can use the framebuffer
 		// color image for sampling during final rendering
@@ -765,7 +791,7 @@ public:
 		// Submit work
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &offScreenCmdBuffer;
-		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
+		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, offscreenFence));
 
 		// Scene rendering
 
@@ -783,7 +809,10 @@ public:
 
 	void prepare()
 	{
+		vks::CpuProfiler::Zone zone("prepare");
 		VulkanExampleBase::prepare();
+		gbufferProfilerSlot = static_cast<uint32_t>(drawCmdBuffers.size());
+		gpuProfiler.create(vulkanDevice, gbufferProfilerSlot + 1);
 		loadAssets();
 		prepareOffscreenFramebuffer();
 		prepareUniformBuffers();
@@ -287,15 +287,18 @@ public:
 	}
 
 	// Put render commands for the scene into the given command buffer
+	// The shadow pass only reads positions and uses the position only vertex streams of the models
 	void renderScene(VkCommandBuffer cmdBuffer, bool shadow)
 	{
+		const uint32_t renderFlags = shadow ? vkglTF::RenderFlags::DepthOnly : 0;
+
 		// Background
 		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, shadow ? &descriptorSets.shadow : &descriptorSets.background, 0, NULL);
-		models.background.draw(cmdBuffer);
+		models.background.draw(cmdBuffer, renderFlags);
 
 		// Objects
 		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, shadow ? &descriptorSets.shadow : &descriptorSets.model, 0, NULL);
-		models.model.bindBuffers(cmdBuffer);
+		models.model.bindBuffers(cmdBuffer, renderFlags);
 		vkCmdDrawIndexed(cmdBuffer, models.model.indices.count, 3, 0, 0, 0);
 	}
 
@@ -383,7 +386,7 @@ public:
 
 	void loadAssets()
 	{
-		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
+		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY | vkglTF::FileLoadingFlags::PositionOnlyStream;
 		models.model.loadFromFile(getAssetPath() + "models/armor/armor.gltf", vulkanDevice, queue, glTFLoadingFlags);
 		models.background.loadFromFile(getAssetPath() + "models/deferred_box.gltf", vulkanDevice, queue, glTFLoadingFlags);
 		textures.model.colorMap.loadFromFile(getAssetPath() + "models/armor/colormap_rgba.ktx", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, queue);
@@ -628,6 +631,7 @@ public:
 
 		pipelineCI.pStages = shadowStages.data();
 		pipelineCI.stageCount = static_cast<uint32_t>(shadowStages.size());
+		pipelineCI.pVertexInputState = vkglTF::PackedVertex::getPipelineVertexInputState({ vkglTF::VertexComponent::Position });
 
 		// Shadow pass doesn't use any color attachments
 		colorBlendState.attachmentCount = 0;
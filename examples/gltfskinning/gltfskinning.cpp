@@ -53,7 +53,10 @@ VulkanglTFModel::~VulkanglTFModel()
 	}
 	for (Skin skin : skins)
 	{
-		skin.ssbo.destroy();
+		for (auto &ssbo : skin.ssbos)
+		{
+			ssbo.destroy();
+		}
 	}
 }
 
@@ -200,14 +203,18 @@ void VulkanglTFModel::loadSkins(tinygltf::Model &input)
 			memcpy(skins[i].inverseBindMatrices.data(), &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::mat4));
 
 			// Store inverse bind matrices for this skin in a shader storage buffer object
-			// To keep this sample simple, we create a host visible shader storage buffer
-			VK_CHECK_RESULT(vulkanDevice->createBuffer(
-			    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-			    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			    &skins[i].ssbo,
-			    sizeof(glm::mat4) * skins[i].inverseBindMatrices.size(),
-			    skins[i].inverseBindMatrices.data()));
-			VK_CHECK_RESULT(skins[i].ssbo.map());
+			// To keep this sample simple, we create host visible shader storage buffers
+			skins[i].ssbos.resize(bufferCount);
+			for (auto &ssbo : skins[i].ssbos)
+			{
+				VK_CHECK_RESULT(vulkanDevice->createBuffer(
+				    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				    &ssbo,
+				    sizeof(glm::mat4) * skins[i].inverseBindMatrices.size(),
+				    skins[i].inverseBindMatrices.data()));
+				VK_CHECK_RESULT(ssbo.map());
+			}
 		}
 	}
 }
@@ -490,7 +497,7 @@ glm::mat4 VulkanglTFModel::getNodeMatrix(VulkanglTFModel::Node *node)
 }
 
 // POI: Update the joint matrices from the current animation frame and pass them to the GPU
-void VulkanglTFModel::updateJoints(VulkanglTFModel::Node *node)
+void VulkanglTFModel::updateJoints(VulkanglTFModel::Node *node, uint32_t bufferIndex)
 {
 	if (node->skin > -1)
 	{
@@ -504,18 +511,18 @@ void VulkanglTFModel::updateJoints(VulkanglTFModel::Node *node)
 			jointMatrices[i] = getNodeMatrix(skin.joints[i]) * skin.inverseBindMatrices[i];
 			jointMatrices[i] = inverseTransform * jointMatrices[i];
 		}
-		// Update ssbo
-		skin.ssbo.copyTo(jointMatrices.data(), jointMatrices.size() * sizeof(glm::mat4));
+		// Update the ssbo used by the current frame
+		skin.ssbos[bufferIndex].copyTo(jointMatrices.data(), jointMatrices.size() * sizeof(glm::mat4));
 	}
 
 	for (auto &child : node->children)
 	{
-		updateJoints(child);
+		updateJoints(child, bufferIndex);
 	}
 }
 
 // POI: Update the current animation
-void VulkanglTFModel::updateAnimation(float deltaTime)
+void VulkanglTFModel::updateAnimation(float deltaTime, uint32_t bufferIndex)
 {
 	if (activeAnimation > static_cast<uint32_t>(animations.size()) - 1)
 	{
@@ -573,7 +580,7 @@ void VulkanglTFModel::updateAnimation(float deltaTime)
 	}
 	for (auto &node : nodes)
 	{
-		updateJoints(node);
+		updateJoints(node, bufferIndex);
 	}
 }
 
@@ -582,7 +589,7 @@ void VulkanglTFModel::updateAnimation(float deltaTime)
 */
 
 // Draw a single node including child nodes (if present)
-void VulkanglTFModel::drawNode(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VulkanglTFModel::Node node)
+void VulkanglTFModel::drawNode(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VulkanglTFModel::Node node, uint32_t bufferIndex)
 {
 	if (node.mesh.primitives.size() > 0)
 	{
@@ -598,7 +605,7 @@ void VulkanglTFModel::drawNode(VkCommandBuffer commandBuffer, VkPipelineLayout p
 		// Pass the final matrix to the vertex shader using push constants
 		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &nodeMatrix);
 		// Bind SSBO with skin data for this node to set 1
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &skins[node.skin].descriptorSet, 0, nullptr);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &skins[node.skin].descriptorSets[bufferIndex], 0, nullptr);
 		for (VulkanglTFModel::Primitive &primitive : node.mesh.primitives)
 		{
 			if (primitive.indexCount > 0)
@@ -613,12 +620,12 @@ void VulkanglTFModel::drawNode(VkCommandBuffer commandBuffer, VkPipelineLayout p
 	}
 	for (auto &child : node.children)
 	{
-		drawNode(commandBuffer, pipelineLayout, *child);
+		drawNode(commandBuffer, pipelineLayout, *child, bufferIndex);
 	}
 }
 
 // Draw the glTF scene starting at the top-level-nodes
-void VulkanglTFModel::draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout)
+void VulkanglTFModel::draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t bufferIndex)
 {
 	// All vertices and indices are stored in single buffers, so we only need to bind once
 	VkDeviceSize offsets[1] = {0};
@@ -627,7 +634,7 @@ void VulkanglTFModel::draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipel
 	// Render all nodes at top-level
 	for (auto &node : nodes)
 	{
-		drawNode(commandBuffer, pipelineLayout, *node);
+		drawNode(commandBuffer, pipelineLayout, *node, bufferIndex);
 	}
 }
 
@@ -646,6 +653,8 @@ VulkanExample::VulkanExample() :
 	camera.setPosition(glm::vec3(0.0f, 0.75f, -2.0f));
 	camera.setRotation(glm::vec3(0.0f, 0.0f, 0.0f));
 	camera.setPerspective(60.0f, (float) width / (float) height, 0.1f, 256.0f);
+	// Uniform and joint buffers are kept per frame in flight and the command buffer is recorded every frame
+	settings.multipleFramesInFlight = true;
 }
 
 VulkanExample::~VulkanExample()
@@ -661,7 +670,10 @@ VulkanExample::~VulkanExample()
 	vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.textures, nullptr);
 	vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.jointMatrices, nullptr);
 
-	shaderData.buffer.destroy();
+	for (auto &buffer : shaderData.buffers)
+	{
+		buffer.destroy();
+	}
 }
 
 void VulkanExample::getEnabledFeatures()
@@ -673,7 +685,8 @@ void VulkanExample::getEnabledFeatures()
 	};
 }
 
-void VulkanExample::buildCommandBuffers()
+// Records the command buffer of the acquired swap chain image, using the uniform and joint buffers of the current frame
+void VulkanExample::buildCommandBuffer()
 {
 	VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
 
@@ -690,25 +703,23 @@ void VulkanExample::buildCommandBuffers()
 	renderPassBeginInfo.renderArea.extent.height = height;
 	renderPassBeginInfo.clearValueCount          = 2;
 	renderPassBeginInfo.pClearValues             = clearValues;
+	renderPassBeginInfo.framebuffer              = frameBuffers[currentBuffer];
 
 	const VkViewport viewport = vks::initializers::viewport((float) width, (float) height, 0.0f, 1.0f);
 	const VkRect2D   scissor  = vks::initializers::rect2D(width, height, 0, 0);
 
-	for (int32_t i = 0; i < drawCmdBuffers.size(); ++i)
-	{
-		renderPassBeginInfo.framebuffer = frameBuffers[i];
-		VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
-		vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
-		vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
-		// Bind scene matrices descriptor to set 0
-		vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
-		vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, wireframe ? pipelines.wireframe : pipelines.solid);
-		glTFModel.draw(drawCmdBuffers[i], pipelineLayout);
-		drawUI(drawCmdBuffers[i]);
-		vkCmdEndRenderPass(drawCmdBuffers[i]);
-		VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
-	}
+	VkCommandBuffer commandBuffer = drawCmdBuffers[currentBuffer];
+	VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &cmdBufInfo));
+	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	// Bind scene matrices descriptor to set 0
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, wireframe ? pipelines.wireframe : pipelines.solid);
+	glTFModel.draw(commandBuffer, pipelineLayout, currentFrame);
+	drawUI(commandBuffer);
+	vkCmdEndRenderPass(commandBuffer);
+	VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
 }
 
 void VulkanExample::loadglTFFile(std::string filename)
@@ -729,6 +740,7 @@ void VulkanExample::loadglTFFile(std::string filename)
 	// Pass some Vulkan resources required for setup and rendering to the glTF model loading class
 	glTFModel.vulkanDevice = vulkanDevice;
 	glTFModel.copyQueue    = queue;
+	glTFModel.bufferCount  = settings.framesInFlight;
 
 	std::vector<uint32_t>                indexBuffer;
 	std::vector<VulkanglTFModel::Vertex> vertexBuffer;
@@ -747,9 +759,12 @@ void VulkanExample::loadglTFFile(std::string filename)
 		glTFModel.loadSkins(glTFInput);
 		glTFModel.loadAnimations(glTFInput);
 		// Calculate initial pose
-		for (auto node : glTFModel.nodes)
+		for (uint32_t i = 0; i < glTFModel.bufferCount; i++)
 		{
-			glTFModel.updateJoints(node);
+			for (auto node : glTFModel.nodes)
+			{
+				glTFModel.updateJoints(node, i);
+			}
 		}
 	}
 	else
@@ -822,15 +837,18 @@ void VulkanExample::setupDescriptors()
 		This sample uses separate descriptor sets (and layouts) for the matrices and materials (textures)
 	*/
 
+	// Buffers updated every frame have one copy per frame in flight
+	const uint32_t bufferCount = static_cast<uint32_t>(shaderData.buffers.size());
+
 	std::vector<VkDescriptorPoolSize> poolSizes = {
-	    vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
+	    vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, bufferCount),
 	    // One combined image sampler per material image/texture
 	    vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<uint32_t>(glTFModel.images.size())),
-	    // One ssbo per skin
-	    vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(glTFModel.skins.size())),
+	    // One ssbo per skin and buffer copy
+	    vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(glTFModel.skins.size()) * bufferCount),
 	};
-	// Number of descriptor sets = One for the scene ubo + one per image + one per skin
-	const uint32_t             maxSetCount        = static_cast<uint32_t>(glTFModel.images.size()) + static_cast<uint32_t>(glTFModel.skins.size()) + 1;
+	// Number of descriptor sets = One for the scene ubo + one per image + one per skin (for each buffer copy)
+	const uint32_t             maxSetCount        = static_cast<uint32_t>(glTFModel.images.size()) + (static_cast<uint32_t>(glTFModel.skins.size()) + 1) * bufferCount;
 	VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, maxSetCount);
 	VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
 
@@ -867,19 +885,27 @@ void VulkanExample::setupDescriptors()
 	pipelineLayoutCI.pPushConstantRanges    = &pushConstantRange;
 	VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCI, nullptr, &pipelineLayout));
 
-	// Descriptor set for scene matrices
-	VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayouts.matrices, 1);
-	VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
-	VkWriteDescriptorSet writeDescriptorSet = vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &shaderData.buffer.descriptor);
-	vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+	// Descriptor sets for scene matrices
+	descriptorSets.resize(bufferCount);
+	for (uint32_t i = 0; i < bufferCount; i++)
+	{
+		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayouts.matrices, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSets[i]));
+		VkWriteDescriptorSet writeDescriptorSet = vks::initializers::writeDescriptorSet(descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &shaderData.buffers[i].descriptor);
+		vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+	}
 
-	// Descriptor set for glTF model skin joint matrices
+	// Descriptor sets for glTF model skin joint matrices
 	for (auto &skin : glTFModel.skins)
 	{
-		const VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayouts.jointMatrices, 1);
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &skin.descriptorSet));
-		VkWriteDescriptorSet writeDescriptorSet = vks::initializers::writeDescriptorSet(skin.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &skin.ssbo.descriptor);
-		vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+		skin.descriptorSets.resize(bufferCount);
+		for (uint32_t i = 0; i < bufferCount; i++)
+		{
+			const VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayouts.jointMatrices, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &skin.descriptorSets[i]));
+			VkWriteDescriptorSet writeDescriptorSet = vks::initializers::writeDescriptorSet(skin.descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &skin.ssbos[i].descriptor);
+			vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+		}
 	}
 
 	// Descriptor sets for glTF model materials
@@ -953,16 +979,21 @@ void VulkanExample::preparePipelines()
 
 void VulkanExample::prepareUniformBuffers()
 {
-	VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &shaderData.buffer, sizeof(shaderData.values)));
-	VK_CHECK_RESULT(shaderData.buffer.map());
-	updateUniformBuffers();
+	// Each frame in flight gets its own copy of the uniform buffer
+	shaderData.buffers.resize(settings.framesInFlight);
+	for (uint32_t i = 0; i < shaderData.buffers.size(); i++)
+	{
+		VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &shaderData.buffers[i], sizeof(shaderData.values)));
+		VK_CHECK_RESULT(shaderData.buffers[i].map());
+		updateUniformBuffers(i);
+	}
 }
 
-void VulkanExample::updateUniformBuffers()
+void VulkanExample::updateUniformBuffers(uint32_t bufferIndex)
 {
 	shaderData.values.projection = camera.matrices.perspective;
 	shaderData.values.model      = camera.matrices.view;
-	memcpy(shaderData.buffer.mapped, &shaderData.values, sizeof(shaderData.values));
+	memcpy(shaderData.buffers[bufferIndex].mapped, &shaderData.values, sizeof(shaderData.values));
 }
 
 void VulkanExample::loadAssets()
@@ -977,37 +1008,29 @@ void VulkanExample::prepare()
 	prepareUniformBuffers();
 	setupDescriptors();
 	preparePipelines();
-	buildCommandBuffers();
 	prepared = true;
 }
 
 void VulkanExample::render()
 {
-	renderFrame();
-	if (camera.updated)
-	{
-		updateUniformBuffers();
-	}
-	// POI: Advance animation
-	if (!paused)
-	{
-		glTFModel.updateAnimation(frameTimer);
-	}
-}
-
-void VulkanExample::viewChanged()
-{
-	updateUniformBuffers();
+	VulkanExampleBase::prepareFrame();
+	// The buffers of the current frame and the command buffer of the acquired image are no longer in use by the GPU once prepareFrame() returns
+	updateUniformBuffers(currentFrame);
+	// POI: Advance animation (a zero delta keeps the current pose when paused)
+	glTFModel.updateAnimation(paused ? 0.0f : frameTimer, currentFrame);
+	buildCommandBuffer();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers    = &drawCmdBuffers[currentBuffer];
+	VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
+	VulkanExampleBase::submitFrame();
 }
 
 void VulkanExample::OnUpdateUIOverlay(vks::UIOverlay *overlay)
 {
 	if (overlay->header("Settings"))
 	{
-		if (overlay->checkBox("Wireframe", &wireframe))
-		{
-			buildCommandBuffers();
-		}
+		// The command buffer is recorded every frame, so a changed checkbox is picked up with the next frame
+		overlay->checkBox("Wireframe", &wireframe);
 	}
 }
 
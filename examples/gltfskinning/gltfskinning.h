@@ -130,8 +130,9 @@ class VulkanglTFModel
 		Node *                 skeletonRoot = nullptr;
 		std::vector<glm::mat4> inverseBindMatrices;
 		std::vector<Node *>    joints;
-		vks::Buffer            ssbo;
-		VkDescriptorSet        descriptorSet;
+		// One joint matrix buffer (and descriptor set) per frame in flight, so a frame in flight never reads matrices written for a later frame
+		std::vector<vks::Buffer>     ssbos;
+		std::vector<VkDescriptorSet> descriptorSets;
 	};
 
 	/*
@@ -170,6 +171,8 @@ class VulkanglTFModel
 	std::vector<Animation> animations;
 
 	uint32_t activeAnimation = 0;
+	// Number of copies for buffers that are updated every frame (one per frame in flight)
+	uint32_t bufferCount = 1;
 
 	~VulkanglTFModel();
 	void      loadImages(tinygltf::Model &input);
@@ -181,10 +184,10 @@ class VulkanglTFModel
 	void      loadAnimations(tinygltf::Model &input);
 	void      loadNode(const tinygltf::Node &inputNode, const tinygltf::Model &input, VulkanglTFModel::Node *parent, uint32_t nodeIndex, std::vector<uint32_t> &indexBuffer, std::vector<VulkanglTFModel::Vertex> &vertexBuffer);
 	glm::mat4 getNodeMatrix(VulkanglTFModel::Node *node);
-	void      updateJoints(VulkanglTFModel::Node *node);
-	void      updateAnimation(float deltaTime);
-	void      drawNode(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VulkanglTFModel::Node node);
-	void      draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout);
+	void      updateJoints(VulkanglTFModel::Node *node, uint32_t bufferIndex);
+	void      updateAnimation(float deltaTime, uint32_t bufferIndex);
+	void      drawNode(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VulkanglTFModel::Node node, uint32_t bufferIndex);
+	void      draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t bufferIndex);
 };
 
 class VulkanExample : public VulkanExampleBase
@@ -194,7 +197,8 @@ class VulkanExample : public VulkanExampleBase
 
 	struct ShaderData
 	{
-		vks::Buffer buffer;
+		// One uniform buffer per frame in flight, updated right before that frame's command buffer is recorded
+		std::vector<vks::Buffer> buffers;
 		struct Values
 		{
 			glm::mat4 projection;
@@ -216,7 +220,7 @@ class VulkanExample : public VulkanExampleBase
 		VkDescriptorSetLayout textures;
 		VkDescriptorSetLayout jointMatrices;
 	} descriptorSetLayouts;
-	VkDescriptorSet descriptorSet;
+	std::vector<VkDescriptorSet> descriptorSets;
 
 	VulkanglTFModel glTFModel;
 
@@ -224,14 +228,13 @@ class VulkanExample : public VulkanExampleBase
 	~VulkanExample();
 	void         loadglTFFile(std::string filename);
 	virtual void getEnabledFeatures();
-	void         buildCommandBuffers();
+	void         buildCommandBuffer();
 	void         loadAssets();
 	void         setupDescriptors();
 	void         preparePipelines();
 	void         prepareUniformBuffers();
-	void         updateUniformBuffers();
+	void         updateUniformBuffers(uint32_t bufferIndex);
 	void         prepare();
 	virtual void render();
-	virtual void viewChanged();
 	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay);
 };
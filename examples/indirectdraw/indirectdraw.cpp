@@ -175,7 +175,7 @@ public:
 			// Binding point 1 : Instance data buffer
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], INSTANCE_BUFFER_BIND_ID, 1, &instanceBuffer.buffer, offsets);
 
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.plants.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.plants.indices.buffer, 0, models.plants.indices.type);
 
 			// If the multi draw feature is supported:
 			// One draw call for an arbitrary number of objects
@@ -362,6 +362,7 @@ public:
 				// A glTF node may consist of multiple primitives, so we may have to do multiple commands per mesh
 				indirectCmd.firstIndex = node->mesh->primitives[0]->firstIndex;
 				indirectCmd.indexCount = node->mesh->primitives[0]->indexCount;
+				indirectCmd.vertexOffset = node->mesh->primitives[0]->vertexOffset;
 
 				indirectCommands.push_back(indirectCmd);
 
@@ -402,7 +403,7 @@ public:
 		std::vector<InstanceData> instanceData;
 		instanceData.resize(objectCount);
 
-		std::default_random_engine rndEngine(benchmark.active ? 0 : (unsigned)time(nullptr));
+		std::default_random_engine rndEngine(getRandomSeed());
 		std::uniform_real_distribution<float> uniformDist(0.0f, 1.0f);
 
 		for (uint32_t i = 0; i < objectCount; i++) {
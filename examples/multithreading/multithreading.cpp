@@ -38,13 +38,15 @@ public:
 
 	VkPipelineLayout pipelineLayout;
 
-	VkCommandBuffer primaryCommandBuffer;
+	// One primary command buffer per frame in flight
+	std::vector<VkCommandBuffer> primaryCommandBuffers;
 
-	// Secondary scene command buffers used to store backdrop and user interface
+	// Secondary scene command buffers used to store backdrop and user interface (one set per frame in flight)
 	struct SecondaryCommandBuffers {
 		VkCommandBuffer background;
 		VkCommandBuffer ui;
-	} secondaryCommandBuffers;
+	};
+	std::vector<SecondaryCommandBuffers> secondaryCommandBuffers;
 
 	// Number of animated objects to be renderer
 	// by using threads and secondary command buffers
@@ -75,8 +77,8 @@ public:
 
 	struct ThreadData {
 		VkCommandPool commandPool;
-		// One command buffer per render object
-		std::vector<VkCommandBuffer> commandBuffer;
+		// One command buffer per render object for each frame in flight
+		std::vector<std::vector<VkCommandBuffer>> commandBuffer;
 		// One push constant block per render object
 		std::vector<ThreadPushConstantBlock> pushConstBlock;
 		// Per object information (position, rotation, etc.)
@@ -86,12 +88,18 @@ public:
 
 	vks::ThreadPool threadPool;
 
-	// Fence to wait for all command buffers to finish before
-	// presenting to the swap chain
-	VkFence renderFence = {};
+	// Fences to wait for all command buffers of a frame to finish before
+	// they are recorded again (one per frame in flight)
+	std::vector<VkFence> renderFences;
 
 	// View frustum for culling invisible objects
 	vks::Frustum frustum;
+	// Bounding spheres of all objects (thread after thread) as structure of arrays for the batch frustum test, objects don't move so they're set up once
+	struct CullingData {
+		std::vector<float> x, y, z, radius;
+		// One bit per object, see vks::Frustum::checkSpheres
+		std::vector<uint32_t> visibility;
+	} culling;
 
 	std::default_random_engine rndEngine;
 
@@ -112,8 +120,14 @@ public:
 		std::cout << "numThreads = " << numThreads << std::endl;
 #endif
 		threadPool.setThreadCount(numThreads);
+		for (uint32_t t = 0; t < numThreads; t++) {
+			threadPool.threads[t]->addJob([t] { vks::CpuProfiler::setThreadName("worker " + std::to_string(t)); });
+		}
+		threadPool.wait();
 		numObjectsPerThread = 512 / numThreads;
-		rndEngine.seed(benchmark.active ? 0 : (unsigned)time(nullptr));
+		rndEngine.seed(getRandomSeed());
+		// Command buffers are recorded per frame in flight
+		settings.multipleFramesInFlight = true;
 	}
 
 	~VulkanExample()
@@ -126,11 +140,15 @@ public:
 		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 
 		for (auto& thread : threadData) {
-			vkFreeCommandBuffers(device, thread.commandPool, thread.commandBuffer.size(), thread.commandBuffer.data());
+			for (auto& commandBuffers : thread.commandBuffer) {
+				vkFreeCommandBuffers(device, thread.commandPool, commandBuffers.size(), commandBuffers.data());
+			}
 			vkDestroyCommandPool(device, thread.commandPool, nullptr);
 		}
 
-		vkDestroyFence(device, renderFence, nullptr);
+		for (auto& fence : renderFences) {
+			vkDestroyFence(device, fence, nullptr);
+		}
 	}
 
 	float rnd(float range)
@@ -144,18 +162,25 @@ public:
 	{
 		// Since this demo updates the command buffers on each frame
 		// we don't use the per-framebuffer command buffers from the
-		// base class, and create a single primary command buffer instead
+		// base class, and create one primary command buffer per frame in flight instead
+		// so the next frame can be recorded while the GPU is still executing the previous one
+		const uint32_t frameCount = settings.framesInFlight;
+		primaryCommandBuffers.resize(frameCount);
 		VkCommandBufferAllocateInfo cmdBufAllocateInfo =
 			vks::initializers::commandBufferAllocateInfo(
 				cmdPool,
 				VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-				1);
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &primaryCommandBuffer));
+				frameCount);
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, primaryCommandBuffers.data()));
 
 		// Create additional secondary CBs for background and ui
+		secondaryCommandBuffers.resize(frameCount);
 		cmdBufAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &secondaryCommandBuffers.background));
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &secondaryCommandBuffers.ui));
+		cmdBufAllocateInfo.commandBufferCount = 1;
+		for (auto& secondaryCommandBuffer : secondaryCommandBuffers) {
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &secondaryCommandBuffer.background));
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &secondaryCommandBuffer.ui));
+		}
 
 		threadData.resize(numThreads);
 
@@ -172,15 +197,18 @@ public:
 			cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 			VK_CHECK_RESULT(vkCreateCommandPool(device, &cmdPoolInfo, nullptr, &thread->commandPool));
 
-			// One secondary command buffer per object that is updated by this thread
-			thread->commandBuffer.resize(numObjectsPerThread);
-			// Generate secondary command buffers for each thread
-			VkCommandBufferAllocateInfo secondaryCmdBufAllocateInfo =
-				vks::initializers::commandBufferAllocateInfo(
-					thread->commandPool,
-					VK_COMMAND_BUFFER_LEVEL_SECONDARY,
-					thread->commandBuffer.size());
-			VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &secondaryCmdBufAllocateInfo, thread->commandBuffer.data()));
+			// One secondary command buffer per object and frame in flight that is updated by this thread
+			thread->commandBuffer.resize(frameCount);
+			for (auto& commandBuffers : thread->commandBuffer) {
+				commandBuffers.resize(numObjectsPerThread);
+				// Generate secondary command buffers for each thread
+				VkCommandBufferAllocateInfo secondaryCmdBufAllocateInfo =
+					vks::initializers::commandBufferAllocateInfo(
+						thread->commandPool,
+						VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+						commandBuffers.size());
+				VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &secondaryCmdBufAllocateInfo, commandBuffers.data()));
+			}
 
 			thread->pushConstBlock.resize(numObjectsPerThread);
 			thread->objectData.resize(numObjectsPerThread);
@@ -197,30 +225,30 @@ public:
 				thread->objectData[j].scale = 0.75f + rnd(0.5f);
 
 				thread->pushConstBlock[j].color = glm::vec3(rnd(1.0f), rnd(1.0f), rnd(1.0f));
+
+				// Simple sphere based on the radius of the mesh
+				culling.x.push_back(thread->objectData[j].pos.x);
+				culling.y.push_back(thread->objectData[j].pos.y);
+				culling.z.push_back(thread->objectData[j].pos.z);
+				culling.radius.push_back(models.ufo.dimensions.radius * 0.5f);
 			}
 		}
+		culling.visibility.resize((culling.x.size() + 31) / 32);
 
 	}
 
 	// Builds the secondary command buffer for each thread
-	void threadRenderCode(uint32_t threadIndex, uint32_t cmdBufferIndex, VkCommandBufferInheritanceInfo inheritanceInfo)
+	void threadRenderCode(uint32_t threadIndex, uint32_t frameIndex, uint32_t cmdBufferIndex, VkCommandBufferInheritanceInfo inheritanceInfo)
 	{
+		vks::CpuProfiler::Zone zone("threadRenderCode");
 		ThreadData *thread = &threadData[threadIndex];
 		ObjectData *objectData = &thread->objectData[cmdBufferIndex];
 
-		// Check visibility against view frustum using a simple sphere check based on the radius of the mesh
-		objectData->visible = frustum.checkSphere(objectData->pos, models.ufo.dimensions.radius * 0.5f);
-
-		if (!objectData->visible)
-		{
-			return;
-		}
-
 		VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::commandBufferBeginInfo();
 		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
 		commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
 
-		VkCommandBuffer cmdBuffer = thread->commandBuffer[cmdBufferIndex];
+		VkCommandBuffer cmdBuffer = thread->commandBuffer[frameIndex][cmdBufferIndex];
 
 		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &commandBufferBeginInfo));
 
@@ -264,13 +292,13 @@ public:
 
 		VkDeviceSize offsets[1] = { 0 };
 		vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &models.ufo.vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(cmdBuffer, models.ufo.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdBindIndexBuffer(cmdBuffer, models.ufo.indices.buffer, 0, models.ufo.indices.type);
 		vkCmdDrawIndexed(cmdBuffer, models.ufo.indices.count, 1, 0, 0, 0);
 
 		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
 	}
 
-	void updateSecondaryCommandBuffers(VkCommandBufferInheritanceInfo inheritanceInfo)
+	void updateSecondaryCommandBuffers(const SecondaryCommandBuffers& secondaryCommandBuffers, VkCommandBufferInheritanceInfo inheritanceInfo)
 	{
 		// Secondary command buffer for the sky sphere
 		VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::commandBufferBeginInfo();
@@ -331,6 +359,7 @@ public:
 	// lat submitted to the queue for rendering
 	void updateCommandBuffers(VkFramebuffer frameBuffer)
 	{
+		vks::CpuProfiler::Zone zone("updateCommandBuffers");
 		// Contains the list of secondary command buffers to be submitted
 		std::vector<VkCommandBuffer> commandBuffers;
 
@@ -352,6 +381,7 @@ public:
 
 		// Set target frame buffer
 
+		VkCommandBuffer primaryCommandBuffer = primaryCommandBuffers[currentFrame];
 		VK_CHECK_RESULT(vkBeginCommandBuffer(primaryCommandBuffer, &cmdBufInfo));
 
 		// The primary command buffer does not contain any rendering commands
@@ -365,22 +395,38 @@ public:
 		inheritanceInfo.framebuffer = frameBuffer;
 
 		// Update secondary sene command buffers
-		updateSecondaryCommandBuffers(inheritanceInfo);
+		const SecondaryCommandBuffers& frameSecondaryCommandBuffers = secondaryCommandBuffers[currentFrame];
+		updateSecondaryCommandBuffers(frameSecondaryCommandBuffers, inheritanceInfo);
 
 		if (displayStarSphere) {
-			commandBuffers.push_back(secondaryCommandBuffers.background);
+			commandBuffers.push_back(frameSecondaryCommandBuffers.background);
+		}
+
+		// Check visibility of all objects against the view frustum at once, so the threads only record command buffers for visible objects
+		{
+			vks::CpuProfiler::Zone cullZone("frustumCulling");
+			frustum.checkSpheres(culling.x.data(), culling.y.data(), culling.z.data(), culling.radius.data(), culling.x.size(), culling.visibility.data());
 		}
 
 		// Add a job to the thread's queue for each object to be rendered
+		const uint32_t frameIndex = currentFrame;
 		for (uint32_t t = 0; t < numThreads; t++)
 		{
 			for (uint32_t i = 0; i < numObjectsPerThread; i++)
 			{
-				threadPool.threads[t]->addJob([=] { threadRenderCode(t, i, inheritanceInfo); });
+				const uint32_t objectIndex = t * numObjectsPerThread + i;
+				threadData[t].objectData[i].visible = (culling.visibility[objectIndex / 32] & (1u << (objectIndex % 32))) != 0;
+				if (threadData[t].objectData[i].visible)
+				{
+					threadPool.threads[t]->addJob([=] { threadRenderCode(t, frameIndex, i, inheritanceInfo); });
+				}
 			}
 		}
 
-		threadPool.wait();
+		{
+			vks::CpuProfiler::Zone waitZone("threadPool.wait");
+			threadPool.wait();
+		}
 
 		// Only submit if object is within the current view frustum
 		for (uint32_t t = 0; t < numThreads; t++)
@@ -389,14 +435,14 @@ public:
 			{
 				if (threadData[t].objectData[i].visible)
 				{
-					commandBuffers.push_back(threadData[t].commandBuffer[i]);
+					commandBuffers.push_back(threadData[t].commandBuffer[frameIndex][i]);
 				}
 			}
 		}
 
 		// Render ui last
 		if (UIOverlay.visible) {
-			commandBuffers.push_back(secondaryCommandBuffers.ui);
+			commandBuffers.push_back(frameSecondaryCommandBuffers.ui);
 		}
 
 		// Execute render commands from the secondary command buffer
@@ -473,6 +519,7 @@ public:
 
 	void updateMatrices()
 	{
+		vks::CpuProfiler::Zone zone("updateMatrices");
 		matrices.projection = camera.matrices.perspective;
 		matrices.view = camera.matrices.view;
 		frustum.update(matrices.projection * matrices.view);
@@ -480,7 +527,8 @@ public:
 
 	void draw()
 	{
-		// Wait for fence to signal that all command buffers are ready
+		// Wait for fence to signal that all command buffers of the current frame are ready to be recorded again
+		VkFence renderFence = renderFences[currentFrame];
 		VkResult fenceRes;
 		do {
 			fenceRes = vkWaitForFences(device, 1, &renderFence, VK_TRUE, 100000000);
@@ -493,7 +541,7 @@ public:
 		updateCommandBuffers(frameBuffers[currentBuffer]);
 
 		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &primaryCommandBuffer;
+		submitInfo.pCommandBuffers = &primaryCommandBuffers[currentFrame];
 
 		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, renderFence));
 
@@ -502,10 +550,14 @@ public:
 
 	void prepare()
 	{
+		vks::CpuProfiler::Zone zone("prepare");
 		VulkanExampleBase::prepare();
-		// Create a fence for synchronization
+		// Create a fence for synchronization per frame in flight
 		VkFenceCreateInfo fenceCreateInfo = vks::initializers::fenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
-		vkCreateFence(device, &fenceCreateInfo, nullptr, &renderFence);
+		renderFences.resize(settings.framesInFlight);
+		for (auto& fence : renderFences) {
+			VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &fence));
+		}
 		loadAssets();
 		setupPipelineLayout();
 		preparePipelines();
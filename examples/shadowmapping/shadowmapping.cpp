@@ -309,7 +309,8 @@ public:
 
 				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.offscreen);
 				vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.offscreen, 0, nullptr);
-				scenes[sceneIndex].draw(drawCmdBuffers[i]);
+				// Only positions are required for the depth pass, so use the position only vertex stream
+				scenes[sceneIndex].draw(drawCmdBuffers[i], vkglTF::RenderFlags::DepthOnly);
 
 				vkCmdEndRenderPass(drawCmdBuffers[i]);
 			}
@@ -365,7 +366,7 @@ public:
 
 	void loadAssets()
 	{
-		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
+		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY | vkglTF::FileLoadingFlags::PositionOnlyStream;
 		scenes.resize(2);
 		scenes[0].loadFromFile(getAssetPath() + "models/vulkanscene_shadow.gltf", vulkanDevice, queue, glTFLoadingFlags);
 		scenes[1].loadFromFile(getAssetPath() + "models/samplescene.gltf", vulkanDevice, queue, glTFLoadingFlags);
@@ -490,6 +491,7 @@ public:
 		// Offscreen pipeline (vertex shader only)
 		shaderStages[0] = loadShader(getShadersPath() + "shadowmapping/offscreen.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 		pipelineCI.stageCount = 1;
+		pipelineCI.pVertexInputState = vkglTF::PackedVertex::getPipelineVertexInputState({vkglTF::VertexComponent::Position});
 		// No blend attachment states (no color attachments used)
 		colorBlendStateCI.attachmentCount = 0;
 		// Disable culling, so all faces contribute to shadows
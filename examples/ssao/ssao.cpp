@@ -492,12 +492,15 @@ public:
 
 	void buildCommandBuffers()
 	{
+		vks::CpuProfiler::Zone zone("buildCommandBuffers");
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
 
 		for (int32_t i = 0; i < drawCmdBuffers.size(); ++i)
 		{
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			gpuProfiler.beginFrame(drawCmdBuffers[i], i);
+
 			/*
 				Offscreen SSAO generation
 			*/
@@ -521,6 +524,7 @@ public:
 					First pass: Fill G-Buffer components (positions+depth, normals, albedo) using MRT
 				*/
 
+				gpuProfiler.beginScope(drawCmdBuffers[i], "gbuffer");
 				vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 				VkViewport viewport = vks::initializers::viewport((float)frameBuffers.offscreen.width, (float)frameBuffers.offscreen.height, 0.0f, 1.0f);
@@ -535,6 +539,7 @@ public:
 				scene.draw(drawCmdBuffers[i], vkglTF::RenderFlags::BindImages, pipelineLayouts.gBuffer);
 
 				vkCmdEndRenderPass(drawCmdBuffers[i]);
+				gpuProfiler.endScope(drawCmdBuffers[i]);
 
 				/*
 					Second pass: SSAO generation
@@ -550,6 +555,7 @@ public:
 				renderPassBeginInfo.clearValueCount = 2;
 				renderPassBeginInfo.pClearValues = clearValues.data();
 
+				gpuProfiler.beginScope(drawCmdBuffers[i], "ssao");
 				vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 				viewport = vks::initializers::viewport((float)frameBuffers.ssao.width, (float)frameBuffers.ssao.height, 0.0f, 1.0f);
@@ -562,6 +568,7 @@ public:
 				vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
 
 				vkCmdEndRenderPass(drawCmdBuffers[i]);
+				gpuProfiler.endScope(drawCmdBuffers[i]);
 
 				/*
 					Third pass: SSAO blur
@@ -572,6 +579,7 @@ public:
 				renderPassBeginInfo.renderArea.extent.width = frameBuffers.ssaoBlur.width;
 				renderPassBeginInfo.renderArea.extent.height = frameBuffers.ssaoBlur.height;
 
+				gpuProfiler.beginScope(drawCmdBuffers[i], "ssao blur");
 				vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 				viewport = vks::initializers::viewport((float)frameBuffers.ssaoBlur.width, (float)frameBuffers.ssaoBlur.height, 0.0f, 1.0f);
@@ -584,6 +592,7 @@ public:
 				vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
 
 				vkCmdEndRenderPass(drawCmdBuffers[i]);
+				gpuProfiler.endScope(drawCmdBuffers[i]);
 			}
 
 			/*
@@ -618,7 +627,9 @@ public:
 
 				// Final composition pass
 				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.composition);
+				gpuProfiler.beginScope(drawCmdBuffers[i], "composition");
 				vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
+				gpuProfiler.endScope(drawCmdBuffers[i]);
 
 				drawUI(drawCmdBuffers[i]);
 
@@ -856,7 +867,7 @@ public:
 		updateUniformBufferSSAOParams();
 
 		// SSAO
-		std::default_random_engine rndEngine(benchmark.active ? 0 : (unsigned)time(nullptr));
+		std::default_random_engine rndEngine(getRandomSeed());
 		std::uniform_real_distribution<float> rndDist(0.0f, 1.0f);
 
 		// Sample kernel
@@ -891,6 +902,7 @@ public:
 
 	void updateUniformBufferMatrices()
 	{
+		vks::CpuProfiler::Zone zone("updateUniformBufferMatrices");
 		uboSceneParams.projection = camera.matrices.perspective;
 		uboSceneParams.view = camera.matrices.view;
 		uboSceneParams.model = glm::mat4(1.0f);
@@ -902,6 +914,7 @@ public:
 
 	void updateUniformBufferSSAOParams()
 	{
+		vks::CpuProfiler::Zone zone("updateUniformBufferSSAOParams");
 		uboSSAOParams.projection = camera.matrices.perspective;
 
 		VK_CHECK_RESULT(uniformBuffers.ssaoParams.map());
@@ -920,7 +933,9 @@ public:
 
 	void prepare()
 	{
+		vks::CpuProfiler::Zone zone("prepare");
 		VulkanExampleBase::prepare();
+		gpuProfiler.create(vulkanDevice, static_cast<uint32_t>(drawCmdBuffers.size()));
 		loadAssets();
 		prepareOffscreenFramebuffers();
 		prepareUniformBuffers();
@@ -175,7 +175,7 @@ public:
 		camera.setPosition(glm::vec3(0.0f, 0.0f, -2.5f));
 		camera.setRotation(glm::vec3(0.0f, 15.0f, 0.0f));
 		camera.setPerspective(60.0f, (float)width / (float)height, 0.1f, 256.0f);
-		srand((unsigned int)time(NULL));
+		srand(getRandomSeed());
 	}
 
 	~VulkanExample()
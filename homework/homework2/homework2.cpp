@@ -116,7 +116,7 @@ void VulkanExample::buildCommandBuffers()
 void VulkanExample::loadAssets()
 {
 	vkglTF::descriptorBindingFlags = vkglTF::DescriptorBindingFlags::ImageBaseColor | vkglTF::DescriptorBindingFlags::ImageNormalMap;
-	scene.loadFromFile(getAssetPath() + "models/sponza/sponza.gltf", vulkanDevice, queue, vkglTF::FileLoadingFlags::PreTransformVertices);
+	scene.loadFromFile(getAssetPath() + "models/sponza/sponza.gltf", vulkanDevice, queue, vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::ParallelImageDecoding | vkglTF::FileLoadingFlags::WeldVertices | vkglTF::FileLoadingFlags::OptimizeMeshes | vkglTF::FileLoadingFlags::RelativeIndices16);
 }
 
 void VulkanExample::setupDescriptors()
@@ -434,6 +434,12 @@ void VulkanExample::OnUpdateUIOverlay(vks::UIOverlay* overlay)
 	if (overlay->checkBox("Color shading rates", &colorShadingRate)) {
 		updateUniformBuffers();
 	}
+	if (overlay->header("Mesh optimization")) {
+		const vkglTF::Model::OptimizationStatistics& statistics = scene.optimizationStatistics;
+		overlay->text("%d triangles", statistics.triangles);
+		overlay->text("ACMR %.3f -> %.3f", statistics.acmrBefore, statistics.acmrAfter);
+		overlay->text("ATVR %.3f -> %.3f", statistics.atvrBefore, statistics.atvrAfter);
+	}
 }
 
 VULKAN_EXAMPLE_MAIN()
@@ -29,7 +29,7 @@ void MVKExample::keyPressed(uint32_t keyChar) {					// SRS - handle keyboard key
 			_vulkanExample->UIOverlay.updated = true;
 			break;
 		default:
-			_vulkanExample->keyPressed(keyChar);
+			_vulkanExample->handleKeyPress(keyChar);
 			break;
 	}
 }